@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Engine.hpp"
+#include "Pdn.hpp"
+
+struct AnalysisOptions {
+    SearchLimits limits;                // for every position
+    std::size_t hashMegabytes = 16;     // per thread
+    unsigned int threads = 1;
+    int blunder = 100;                  // score a move may give away before it is flagged
+};
+
+// Engine verdict on one move of a game, scores for the side that played it
+struct MoveAnalysis {
+    int bestScore = 0;          // of the position before the move
+    int playedScore = 0;        // of the position after it
+    bool blunder = false;       // gave away at least AnalysisOptions::blunder
+    std::vector<Hop> best;
+};
+
+// Searches every position of a set of games on all threads and annotates the games.
+// Work is split into runs of consecutive positions of one game, searched last to first
+// by one engine, so each search finds the table filled by the one after it. Every
+// thread owns a deque of runs: it takes its own from the back, which keeps it walking
+// back through the same game, and steals from the front of the others' when it runs out.
+class GameAnalyzer {
+public:
+    explicit GameAnalyzer(const AnalysisOptions& options);
+
+    // Analyzes games whose moves are legal; the rest are left as they are and counted as
+    // skipped. Returns one entry per game, with one analysis per move.
+    std::vector<std::vector<MoveAnalysis>> analyze(const std::vector<PdnGame>& games);
+
+    // Sets the annotations of a game: the score after every move from White's side in
+    // men, and for blunders a $4 NAG and the best move
+    static void annotate(PdnGame& game, const std::vector<MoveAnalysis>& moves);
+
+    std::uint64_t getPositions() const { return m_positions; }
+    std::uint64_t getNodes() const { return m_nodes; }
+    std::uint64_t getSkippedGames() const { return m_skippedGames; }
+    std::uint64_t getSteals() const { return m_steals; }
+
+private:
+    struct Run {
+        std::size_t game;
+        std::size_t first;      // positions first to last - 1
+        std::size_t last;
+    };
+
+    struct RunQueue {
+        std::mutex mutex;
+        std::deque<Run> runs;
+    };
+
+    AnalysisOptions m_options;
+    std::vector<std::unique_ptr<RunQueue>> m_queues;
+    std::atomic<std::uint64_t> m_positions{0};
+    std::atomic<std::uint64_t> m_nodes{0};
+    std::atomic<std::uint64_t> m_steals{0};
+    std::uint64_t m_skippedGames = 0;
+
+    // The next run for a thread: its own newest, else the oldest of another thread's
+    bool takeRun(unsigned int thread, Run& run);
+};
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <array>
 #include <vector>
 #include "Piece.hpp"
+#include "Position.hpp"
+#include "Rules.hpp"
 
 class Board {
 public:
@@ -12,17 +15,35 @@ public:
         bool canChain = false;
     };
 
+    struct Move {
+        int fromRow;
+        int fromCol;
+        int toRow;
+        int toCol;
+    };
+
+    // The variant played on the board
+    using BoardRules = Rules<variants::Russian>;
+    static constexpr int BOARD_SIZE = BoardRules::Geometry::SIZE;
+
     Board(float boardSize);
     ~Board();
     
     void draw(sf::RenderWindow& window);
     void initializePieces();
+    Position getPosition(PieceColor sideToMove) const;
+    void loadPosition(const Position& position);
     bool movePiece(int fromRow, int fromCol, int toRow, int toCol);
     bool isValidMove(int fromRow, int fromCol, int toRow, int toCol);
     Piece* getPieceAt(int row, int col);
     MoveResult handleClick(float x, float y, PieceColor currentPlayer);
+    MoveResult applyMove(int fromRow, int fromCol, int toRow, int toCol, PieceColor currentPlayer);
+    std::vector<Move> getLegalMoves(PieceColor color);
     std::pair<int, int> getBoardPosition(float x, float y);
     bool playerHasAnyCapture(PieceColor color);
+    // Answered from the cached move list, so checking for the end of the game is cheap
+    bool hasLegalMove(PieceColor color);
+    int getMobility(PieceColor color);
     
     // Getters for the last move
     int getLastMoveFromRow() const { return m_lastMoveFromRow; }
@@ -31,25 +52,38 @@ public:
     int getLastMoveToCol() const { return m_lastMoveToCol; }
 
 private:
-    const int BOARD_SIZE = 8;
     float m_cellSize;
     float m_boardSize;
-    sf::RectangleShape m_cells[8][8];
+    sf::RectangleShape m_cells[BOARD_SIZE][BOARD_SIZE];
     std::vector<Piece*> m_pieces;
     
+    // Rules state: the pieces as bitboards, and which piece stands on each dark square
+    Position m_position;
+    std::array<Piece*, BoardRules::Geometry::SQUARES> m_squares{};
+    
+    // Legal hops per color, generated on first use after the position changes
+    struct MoveCache {
+        bool valid = false;
+        std::vector<Hop> hops;
+    };
+    std::array<MoveCache, 2> m_moveCache;
+    
     Piece* m_selectedPiece = nullptr;
     int m_selectedRow = -1;
     int m_selectedCol = -1;
     
+    // Piece that has to continue a multi-capture, if any
+    Piece* m_chainPiece = nullptr;
+    
     // Track last move for network play
     int m_lastMoveFromRow = -1;
     int m_lastMoveFromCol = -1;
     int m_lastMoveToRow = -1;
     int m_lastMoveToCol = -1;
     
-    bool canCapture(Piece* piece, int toRow, int toCol, int& capturedRow, int& capturedCol);
-    void capturePiece(int row, int col);
-    void checkForPromotion(Piece* piece);
-    bool hasValidMoves(Piece* piece);
-    bool hasValidCapture(Piece* piece);
+    bool findHop(int fromRow, int fromCol, int toRow, int toCol, Hop& hop) const;
+    // Moves the piece and updates the bitboards; returns true if it has to capture again
+    bool playHop(const Hop& hop);
+    const std::vector<Hop>& getLegalHops(PieceColor color);
+    void invalidateMoves();
 }; 
\ No newline at end of file
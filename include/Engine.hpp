@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Evaluator.hpp"
+#include "Network.hpp"
+#include "Position.hpp"
+#include "Rules.hpp"
+
+using EngineRules = Rules<variants::Russian>;
+
+// When to stop searching; zero means no limit
+struct SearchLimits {
+    int depth = 64;             // in turns; the hops of a capture count as one
+    std::uint64_t nodes = 0;
+    int milliseconds = 0;
+    int lines = 1;              // best moves to rank, each with its own variation and score
+};
+
+// Search refinements; each can be turned off to measure what it is worth
+struct SearchOptions {
+    bool nullWindows = true;    // principal variation search: later hops only have to be refuted
+    bool aspiration = true;     // root windows around the last iteration's score
+    bool reductions = true;     // late quiet hops searched shallower unless they turn out good
+    bool pruning = true;        // quiet hops near the leaves skipped when far below alpha
+    bool quiescence = true;     // pending captures searched past the last turn, not just a capture in progress
+    bool ordering = true;       // captures, crownings, killers and history after the table's hop;
+                                // otherwise the rest keep the order they were generated in
+};
+
+// One of the ranked moves of a multi-line search
+struct SearchLine {
+    std::vector<Hop> turn;
+    std::vector<Hop> pv;        // starting with the hops of turn
+    int score = 0;
+    int depth = 0;              // lines searched before the search stopped keep the last one
+};
+
+struct SearchResult {
+    std::vector<SearchLine> lines;  // best first; the first is the move in turn, pv and score
+    std::vector<Hop> turn;      // every hop of the best move; empty if there is none
+    std::vector<Hop> reply;     // the opponent's expected answer to it, if the search got that far
+    std::vector<Hop> pv;        // the principal variation, hop by hop
+    int score = 0;              // for the side to move, in hundredths of a man
+    int depth = 0;              // last depth searched to the end
+    std::uint64_t nodes = 0;
+    double milliseconds = 0;
+};
+
+// Fixed-size hash of search results, one entry per slot, deeper results kept
+class TranspositionTable {
+public:
+    enum Bound : std::uint8_t { Exact, Lower, Upper };
+
+    struct Entry {
+        std::uint64_t key = 0;
+        std::int16_t score = 0;
+        std::int8_t depth = -1;
+        std::uint8_t bound = Exact;
+        std::int8_t from = -1;      // best hop, if one is known
+        std::int8_t to = -1;
+    };
+
+    explicit TranspositionTable(std::size_t megabytes);
+
+    void clear();
+    const Entry* probe(std::uint64_t key) const;
+    void store(std::uint64_t key, int score, int depth, Bound bound, const Hop* best);
+
+private:
+    std::vector<Entry> m_entries;
+    std::size_t m_mask = 0;
+};
+
+// Alpha-beta search over Russian draughts positions, deepened one turn at a time.
+// Nodes are single hops: a capture that has to continue keeps the same side to move and
+// does not use up depth. Past the last turn, pending captures are searched to the end.
+// Scores near WIN mean a forced win in (WIN - score) hops.
+//
+// Several lines are found by searching the root again with the moves already reported
+// left out. Every search shares the hash table, so the later ones are mostly table hits.
+class Engine {
+public:
+    static constexpr int WIN = 30000;
+    static constexpr int MAX_PLY = 256;
+
+    // Called on the searching thread after every completed iteration, and after every
+    // line of one when more than one is wanted
+    using Progress = std::function<void(const SearchResult&)>;
+
+    explicit Engine(std::size_t hashMegabytes = 16);
+
+    // Evaluates with the network instead of the hand-written evaluator when set
+    void setNetwork(std::shared_ptr<const Network> network) { m_network = std::move(network); }
+    void setWeights(const EvalWeights& weights) { m_evaluator = Evaluator(weights); }
+    void setProgress(Progress progress) { m_progress = std::move(progress); }
+    void setOptions(const SearchOptions& options) { m_options = options; }
+    const SearchOptions& getOptions() const { return m_options; }
+
+    SearchResult search(const Position& position, const SearchLimits& limits);
+    // Makes a running search return as soon as it can; safe from other threads. A stop
+    // that comes before the search starts counts too: searches end after their first
+    // iteration until resume() is called.
+    void stop() { m_stopRequested = true; }
+    void resume() { m_stopRequested = false; }
+    // Forgets everything learned from earlier searches
+    void clear();
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr int SQUARES = EngineRules::Geometry::SQUARES;
+
+    Evaluator m_evaluator;
+    std::shared_ptr<const Network> m_network;
+    TranspositionTable m_table;
+    Progress m_progress;
+    SearchOptions m_options;
+
+    // Per-ply scratch space, so the search does not allocate
+    std::array<std::vector<Hop>, MAX_PLY> m_hops;
+    std::array<EvalState, MAX_PLY> m_states;
+    std::array<NnueAccumulator, MAX_PLY> m_accumulators;
+    std::array<std::array<Hop, MAX_PLY>, MAX_PLY> m_pv;
+    std::array<int, MAX_PLY> m_pvLength{};
+
+    // Multi-line search: the root turns already reported at this depth, the hops played
+    // so far, and whether a ply is still part of the first turn
+    bool m_multiLine = false;
+    std::vector<std::vector<Hop>> m_excluded;
+    std::array<Hop, MAX_PLY> m_path;
+    std::array<bool, MAX_PLY> m_rootTurn{};
+
+    // Move ordering: the table's hop first, then captures (of kings first) and crownings,
+    // then the two quiet hops that last caused a cutoff at the ply, then the rest by how
+    // often they caused cutoffs anywhere. Hops are picked best first as they are needed.
+    std::array<std::vector<int>, MAX_PLY> m_scores;
+    std::array<std::array<Hop, 2>, MAX_PLY> m_killers;
+    std::array<std::array<std::array<int, SQUARES>, SQUARES>, 2> m_history{};
+
+    SearchLimits m_limits;
+    Clock::time_point m_start;
+    std::uint64_t m_nodes = 0;
+    bool m_stopped = false;
+    bool m_canStop = false;
+    std::atomic<bool> m_stopRequested{false};
+
+    int negamax(const Position& position, int depth, int alpha, int beta, int ply);
+    // Plays out forced captures past the search horizon, so only quiet positions are evaluated
+    int quiesce(const Position& position, int alpha, int beta, int ply);
+    // Searches the root with a window around the previous score, widening it on failure
+    int searchRoot(const Position& position, int depth, int previous);
+    int evaluate(const Position& position, int ply) const;
+    void playHop(const Position& before, const Hop& hop, const Position& after, int ply);
+    bool shouldStop();
+    void scoreHops(const Position& position, int ply, int hashFrom, int hashTo);
+    // Swaps the best-scored hop from index on into index
+    const Hop& pickHop(int ply, std::size_t index);
+    void recordCutoff(const Position& position, const Hop& hop, int depth, int ply);
+    void ageHistory();
+    // The table's best hop for the position if it is legal, else the first legal one
+    Hop bestStoredHop(const Position& position);
+    // The hops of a variation from index on, up to the end of that side's turn. Plays
+    // them on position and moves index past them.
+    std::vector<Hop> variationTurn(Position& position, const std::vector<Hop>& pv, std::size_t& index);
+    // Whether hop, ending the first turn at ply, completes a turn that was already reported
+    bool isExcluded(const Hop& hop, int ply) const;
+    static std::uint64_t hashKey(const Position& position);
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include "Engine.hpp"
+
+// The engine behind a line-based text protocol in the style of the Hub protocol used by
+// draughts GUIs, so it can run as its own process. Every line is a command followed by
+// key=value arguments; values with spaces are quoted.
+//
+//   hub                          -> id ..., param ... for each parameter, wait
+//   init                         -> ready
+//   ping                         -> pong
+//   set-param name=<p> value=<v>
+//   new-game                     forgets what earlier searches learned
+//   pos [fen=<FEN>] [moves="c3-d4 f6-g5 ..."]   initial position if no FEN
+//   level [depth=<n>] [nodes=<n>] [move-time=<s>] [time=<s> inc=<s>]
+//   go [think|analyze] [level arguments for this search only; analyze ignores the
+//                       level and searches until stop unless given some]
+//                                -> info depth= score= nodes= time= nps= pv="..."
+//                                -> done move=<move> [ponder=<move>]
+//   stop                         the running search sends done before the next command
+//   quit
+//
+// Moves are written with every square of their path, as in PDN ("c3xe5xc7"). Moves
+// read may also give only the first and last square when that is unambiguous. Scores
+// are in hundredths of a man for the side to move; a forced win is near 30000.
+// Searches run on their own thread, so stop is read while one is running.
+class EngineProtocol {
+public:
+    EngineProtocol(std::istream& input, std::ostream& output);
+    ~EngineProtocol();
+
+    // Handles commands until quit or the end of the input
+    void run();
+    // Handles one line; returns false on quit
+    bool handle(const std::string& line);
+
+private:
+    using Arguments = std::map<std::string, std::string>;
+
+    std::istream& m_input;
+    std::ostream& m_output;
+    std::mutex m_outputMutex;
+
+    std::unique_ptr<Engine> m_engine;
+    std::size_t m_hashMegabytes = 16;
+    int m_lines = 1;
+    SearchOptions m_options;
+    Position m_position;
+    Arguments m_level;
+
+    std::thread m_search;
+    std::atomic<bool> m_searching{false};
+
+    void send(const std::string& line);
+    void error(const std::string& message);
+    void sendParams();
+    bool setParam(const std::string& name, const std::string& value);
+    bool setPosition(const Arguments& arguments);
+    bool toLimits(const Arguments& level, SearchLimits& limits);
+    void startSearch(const SearchLimits& limits);
+    // Waits for the search thread once it has sent done
+    void join();
+
+    // The hops of a variation from the position, grouped into moves
+    static std::string pvText(Position position, const std::vector<Hop>& pv);
+};
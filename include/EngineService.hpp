@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Engine.hpp"
+#include "LockFreeQueue.hpp"
+
+// Progress of a search request: one update per completed depth (per line of each depth
+// in a multi-line search), then a final one
+struct EngineUpdate {
+    std::uint64_t request = 0;
+    bool final = false;
+    bool cancelled = false;     // final update of a cancelled search: the best move found so far
+    SearchResult result;
+};
+
+// Runs engine searches on worker threads so the caller (the render loop) never waits
+// for one. Requests are queued and picked up by the first free worker; updates come
+// back through a lock-free queue that the caller drains with poll.
+class EngineService {
+public:
+    explicit EngineService(unsigned int workers = 1, std::size_t hashMegabytes = 16);
+    ~EngineService();
+
+    EngineService(const EngineService&) = delete;
+    EngineService& operator=(const EngineService&) = delete;
+
+    // Queues a search and returns its id, which is never 0
+    std::uint64_t submit(const Position& position, const SearchLimits& limits);
+    // A request that has not started is dropped without any updates; a running one
+    // stops as soon as it can and sends its final update marked as cancelled
+    void cancel(std::uint64_t request);
+    void cancelAll();
+
+    // Takes the next update without blocking. Only one thread may poll.
+    bool poll(EngineUpdate& update);
+
+    // Updates dropped because the caller did not poll fast enough; final updates are
+    // never dropped
+    std::uint64_t getDroppedUpdates() const { return m_dropped; }
+
+private:
+    struct Request {
+        std::uint64_t id;
+        Position position;
+        SearchLimits limits;
+    };
+
+    struct Worker {
+        Engine engine;
+        std::uint64_t request = 0;      // being searched, 0 when idle
+        bool cancelled = false;
+        std::thread thread;
+
+        explicit Worker(std::size_t hashMegabytes)
+            : engine(hashMegabytes) {
+        }
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<Request> m_requests;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::uint64_t m_nextId = 1;
+    std::atomic<bool> m_stopping{false};
+
+    LockFreeQueue<EngineUpdate> m_updates;
+    std::atomic<std::uint64_t> m_dropped{0};
+
+    void work(Worker& worker);
+    void publish(EngineUpdate& update);
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Position.hpp"
+#include "Rules.hpp"
+
+// Evaluation weights, in hundredths of a man
+struct EvalWeights {
+    int man = 100;
+    int king = 300;
+    int backRank = 8;       // man still guarding its own back row
+    int center = 6;         // man on one of the eight central squares
+    int kingCenter = 4;     // king on a central square
+    int tempo = 3;          // per row a man has advanced
+    int runaway = 40;       // man no enemy piece can reach before it is crowned
+
+    // The weights in the order above, as tuners and weight files see them
+    static constexpr int TERMS = 7;
+    static const char* const NAMES[TERMS];
+    std::array<int, TERMS> toArray() const;
+    static EvalWeights fromArray(const std::array<int, TERMS>& values);
+
+    // Text files of "name value" lines; names that are missing keep their defaults
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+};
+
+// How many times each weight counts in a position, White minus Black
+using EvalTerms = std::array<int, EvalWeights::TERMS>;
+
+// Material and piece-square sums, White minus Black. Kept up to date as hops are played
+// so a search does not have to recount the pieces at every node.
+struct EvalState {
+    int score = 0;
+};
+
+// Static evaluation of Russian draughts positions. Material and placement come from one
+// table per piece type and square; runaway men depend on the whole board and are added
+// at evaluation time with a few mask tests per man.
+class Evaluator {
+public:
+    explicit Evaluator(const EvalWeights& weights = EvalWeights());
+
+    const EvalWeights& getWeights() const { return m_weights; }
+
+    EvalState computeState(const Position& position) const;
+    // Brings the state from before to after, where after is before with the hop applied.
+    // To take a hop back, restore the saved state.
+    void update(EvalState& state, const Position& before, const Hop& hop, const Position& after) const;
+
+    // Score for the side to move
+    int evaluate(const Position& position, const EvalState& state) const;
+    int evaluate(const Position& position) const { return evaluate(position, computeState(position)); }
+    // Scores count positions from scratch, as a tuner needs
+    void evaluateBatch(const Position* positions, std::size_t count, int* scores) const;
+
+    // The evaluation is linear in the weights: from White's side it is the dot product
+    // of the weights and these counts
+    static EvalTerms countTerms(const Position& position);
+
+private:
+    using Geometry = tables::Geometry8;
+
+    // White man, white king, black man, black king; black entries are negative
+    static constexpr int PIECE_TYPES = 4;
+
+    EvalWeights m_weights;
+    std::array<std::array<int, Geometry::SQUARES>, PIECE_TYPES> m_pieceSquare;
+
+    static int pieceType(const Position& position, int square);
+    int runawayScore(const Position& position) const;
+};
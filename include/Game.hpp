@@ -2,22 +2,41 @@
 
 #include <SFML/Graphics.hpp>
 #include "Board.hpp"
+#include "EngineService.hpp"
 #include "NetworkManager.hpp"
+#include "PlayerController.hpp"
+#include <memory>
 #include <string>
 
 enum class GameState { MainMenu, Playing, GameOver, MultiplayerMenu, HostMenu, JoinMenu };
-enum class GameMode { LocalGame, NetworkHost, NetworkClient };
+enum class GameMode { LocalGame, NetworkHost, NetworkClient, Spectator };
 
 class Game {
 public:
     Game(int windowWidth, int windowHeight);
+    // Headless game: no window is created and every local turn is played by the controller
+    explicit Game(std::unique_ptr<PlayerController> controller);
     ~Game();
     
     void run();
     
+    // Entry points used instead of the menus when running headless
+    void startLocalGame();
+    bool hostGame(unsigned short port);
+    bool joinGame(const std::string& ip, unsigned short port);
+    bool watchGame(const std::string& ip, unsigned short port, std::uint32_t roomId);
+    void setMoveLimit(int moves) { m_moveLimit = moves; }
+    void setThinkTime(int milliseconds) { m_thinkTimeMs = milliseconds; }
+    
+    bool isFinished() const { return m_gameOver; }
+    const std::string& getResultText() const { return m_winnerText; }
+    int getMoveCount() const { return m_moveCount; }
+    std::string getNetworkMetrics() const { return m_network.getMetricsText(); }
+    
 private:
     sf::RenderWindow m_window;
     Board* m_board;
+    float m_boardSize;
     PieceColor m_currentPlayer;
     bool m_gameOver = false;
     std::string m_winnerText;
@@ -29,6 +48,23 @@ private:
     std::string m_ipAddress;
     GameMode m_gameMode = GameMode::LocalGame;
     bool m_isMyTurn = true;
+    bool m_spectating = false;
+    std::uint32_t m_roomId = 0;     // server room, 0 for peer-to-peer games
+    
+    // Headless play
+    bool m_headless = false;
+    std::unique_ptr<PlayerController> m_controller;
+    int m_moveCount = 0;
+    int m_moveLimit = 500;
+    int m_thinkTimeMs = 0;
+    
+    // Playing the computer: a local game where the engine has Black. Searches run on the
+    // engine service's thread and their results are picked up once per frame.
+    bool m_versusEngine = false;
+    std::unique_ptr<EngineService> m_engine;
+    SearchLimits m_engineLimits;
+    std::uint64_t m_engineRequest = 0;     // search in progress, 0 if none
+    std::string m_engineInfo;
     
     // UI components
     sf::Text m_statusText;
@@ -49,12 +85,25 @@ private:
     void renderJoinMenu();
     void switchPlayer();
     bool isGameOver();
+    static std::string formatClock(std::int64_t micros);
+    
+    // Turn handling shared by mouse input and controllers
+    void commitLocalMove(int fromRow, int fromCol, int toRow, int toCol, const Board::MoveResult& result);
+    void finishTurn();
+    void applyResync(const ResyncMessage& resync);
+    bool canMoveOnline() const;
+    
+    // Headless loop
+    void runHeadless();
+    bool playControllerMove();
     
     // UI helper methods
     sf::RectangleShape createButton(float x, float y, float width, float height, const sf::Color& color);
     sf::Text createButtonText(const std::string& string, float x, float y, unsigned int size);
     
     // Game management
-    void startLocalGame();
     void startNetworkGame(GameMode mode);
-}; 
\ No newline at end of file
+    void startEngineGame();
+    void updateEngine();
+    void cancelEngineSearch();
+}; 
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include "Piece.hpp"
+
+enum class TimeControlType : std::uint8_t {
+    None = 0,       // untimed game
+    Fischer = 1,    // the increment is added after every move
+    Delay = 2       // the first `increment` of every move is not charged
+};
+
+struct TimeControl {
+    TimeControlType type = TimeControlType::None;
+    std::int64_t initialMicros = 0;
+    std::int64_t incrementMicros = 0;
+};
+
+// Clocks of both sides, driven by monotonic timestamps in microseconds
+class GameClock {
+public:
+    explicit GameClock(const TimeControl& timeControl = TimeControl());
+    
+    void start(PieceColor side, std::int64_t now);
+    // Resumes a clock saved elsewhere (e.g. in a journal), with the given side to move
+    void restore(std::int64_t whiteMicros, std::int64_t blackMicros, PieceColor side, std::int64_t now);
+    // Ends the running side's turn and starts the other clock. The lag allowance is
+    // not charged to the mover. Returns false if the mover's flag had fallen.
+    bool completeTurn(std::int64_t now, std::int64_t lagAllowance);
+    
+    std::int64_t getRemaining(PieceColor side, std::int64_t now) const;
+    // Monotonic time at which the running side runs out of time
+    std::int64_t getFlagTime() const;
+    PieceColor getRunningSide() const { return m_running; }
+    bool isTimed() const { return m_timeControl.type != TimeControlType::None; }
+    const TimeControl& getTimeControl() const { return m_timeControl; }
+    
+private:
+    TimeControl m_timeControl;
+    std::int64_t m_remaining[2];
+    PieceColor m_running = PieceColor::White;
+    std::int64_t m_turnStart = 0;
+    
+    std::int64_t charge(std::int64_t elapsed) const;
+    static int index(PieceColor side) { return side == PieceColor::White ? 0 : 1; }
+};
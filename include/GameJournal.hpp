@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Board.hpp"
+#include "GameClock.hpp"
+
+// One move of a journaled game, with both clocks as they stood after it
+struct JournaledMove {
+    std::uint32_t seq;
+    Board::Move move;
+    std::int64_t whiteMicros;
+    std::int64_t blackMicros;
+};
+
+// A game that was still in progress when the journal was last written
+struct JournaledRoom {
+    std::uint32_t roomId = 0;
+    std::uint64_t tokens[2] = {0, 0};
+    TimeControl timeControl;
+    std::vector<JournaledMove> moves;
+};
+
+// Append-only, checksummed log of every server game. All rooms share one file so
+// that a single write and fsync commits whatever every room appended meanwhile
+// (group commit); appending only copies a few dozen bytes into the pending batch.
+//
+// Record layout: [u32 payload size][u32 CRC-32 of payload][payload], little-endian.
+// Recovery stops at the first torn or corrupt record, and the file is then rewritten
+// with just the games still in progress. The commit thread does the same while the
+// server runs, once finished games make up most of a large file.
+class GameJournal {
+public:
+    GameJournal() = default;
+    ~GameJournal();
+    
+    // Replays an existing journal into liveRooms and starts the commit thread
+    bool open(const std::string& path, std::vector<JournaledRoom>& liveRooms);
+    void close();
+    
+    void roomStarted(std::uint32_t roomId, const std::uint64_t tokens[2], const TimeControl& timeControl);
+    void moveMade(std::uint32_t roomId, const JournaledMove& move);
+    void roomFinished(std::uint32_t roomId);
+    
+    std::uint64_t getRecords() const { return m_records; }
+    std::uint64_t getCommits() const { return m_commits; }
+    
+private:
+    std::string m_path;
+    std::FILE* m_file = nullptr;
+    std::thread m_commitThread;
+    
+    // Records appended since the last commit, and the games in progress as of the
+    // last of them
+    std::vector<std::uint8_t> m_pending;
+    std::map<std::uint32_t, JournaledRoom> m_liveRooms;
+    std::uint64_t m_liveRecords = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+    
+    // Size of the file; only the commit thread touches it once open() returns
+    std::uint64_t m_fileBytes = 0;
+    
+    std::atomic<std::uint64_t> m_records{0};
+    std::atomic<std::uint64_t> m_commits{0};
+    
+    // Frames a record into the pending batch; call with m_mutex held
+    void append(const std::uint8_t* payload, std::size_t size);
+    void commitLoop();
+    bool rewrite(const std::vector<JournaledRoom>& liveRooms);
+    // Replaces the file with liveRooms and reopens it for appending
+    bool compact(const std::vector<JournaledRoom>& liveRooms);
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Board.hpp"
+#include "GameClock.hpp"
+#include "GameJournal.hpp"
+#include "LatencyEstimator.hpp"
+#include "Protocol.hpp"
+#include "SocketPoller.hpp"
+#include "TimerWheel.hpp"
+
+struct ServerOptions {
+    unsigned short port = 50001;
+    TimeControl timeControl{TimeControlType::Fischer, 300000000, 3000000};
+    std::int64_t maxLagCompensationMicros = 500000;
+    int maxMoves = 500;     // declare a draw after this many moves, 0 for no limit
+    std::int64_t resumeWindowMicros = RESUME_WINDOW_MICROS;
+    std::size_t resumeBufferEvents = 64;
+    std::size_t spectatorBacklogBytes = 16 * 1024;   // beyond this a spectator gets snapshots instead of moves
+    std::size_t playerBacklogBytes = 1024 * 1024;    // beyond this a player is dropped (and may resume)
+    std::string journalPath;    // empty: games do not survive a restart
+};
+
+// Pairs up clients into rooms, validates and relays their moves and keeps the
+// authoritative game clocks. A single thread serves every room: sockets are
+// multiplexed with poll(), so the open file limit is the only cap on connections, and
+// all clocks share one timer wheel.
+//
+// A player who drops keeps their seat for the resume window. Reconnecting with the
+// session token from GameStart resumes the game: the client gets the position it
+// last saw from the room's event buffer plus the moves it missed, or the current
+// position if the buffer no longer reaches back that far.
+//
+// Spectators can watch any room. Every outgoing message is serialized once into a
+// shared frame that all recipients' send queues point to, so a move costs one
+// allocation however many people watch it. A spectator whose queue backs up has its
+// pending moves discarded and gets the current position once it has caught up.
+//
+// With a journal, games in progress survive a restart: they are replayed from the
+// journal with both seats vacant, and players resume them as after a disconnect.
+class GameServer {
+public:
+    explicit GameServer(const ServerOptions& options);
+
+    bool start();
+    void run();
+    void stop() { m_running = false; }
+
+private:
+    // A packet as it goes on the wire (size prefix included), shared by every recipient
+    using Frame = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+    struct QueuedFrame {
+        Frame frame;
+        std::size_t offset;     // bytes already sent
+        bool droppable;         // may be replaced by a snapshot
+    };
+
+    struct Client {
+        std::uint32_t id = 0;
+        sf::TcpSocket socket;
+        bool greeted = false;
+        bool dropped = false;
+        std::uint32_t roomId = 0;
+        PieceColor color = PieceColor::White;
+        LatencyEstimator latency;
+        std::uint32_t nextPingSequence = 0;
+        TimerWheel::TimerId pingTimer = 0;
+
+        // Spectators watch a room instead of playing in it
+        bool spectator = false;
+        std::uint32_t watchRoomId = 0;
+        bool needsSnapshot = false;
+
+        std::deque<QueuedFrame> outbox;
+        std::size_t outboxBytes = 0;
+    };
+
+    // One applied move (a single hop of a multi-capture) and the state after it
+    struct RoomEvent {
+        std::uint32_t seq;
+        Board::Move move;
+        Position positionAfter;     // includes the side to move
+        int moveCountAfter;
+    };
+
+    struct Room {
+        std::uint32_t id;
+        Board board;
+        PieceColor current = PieceColor::White;
+        std::uint32_t players[2] = {0, 0};   // White, Black; 0 while a seat is vacant
+        std::uint64_t tokens[2] = {0, 0};
+        TimerWheel::TimerId resumeTimers[2] = {0, 0};
+        GameClock clock;
+        TimerWheel::TimerId flagTimer = 0;
+        int moveCount = 0;
+
+        // Last events of the game, for resyncing reconnected players
+        Position startPosition;
+        std::uint32_t eventSeq = 0;
+        std::deque<RoomEvent> events;
+
+        std::unordered_set<std::uint32_t> spectators;
+        Frame snapshotFrame;    // current position for spectators, built on demand
+
+        Room(std::uint32_t roomId, const TimeControl& timeControl)
+            : id(roomId), board(720.f), clock(timeControl) {
+            startPosition = board.getPosition(PieceColor::White);
+        }
+    };
+
+    // Timer payloads carry their kind in the top byte and a client or room id below
+    enum class TimerKind : std::uint8_t { Ping = 1, Flag = 2, Stats = 3, Resume = 4 };
+
+    ServerOptions m_options;
+    std::atomic<bool> m_running;
+    sf::TcpListener m_listener;
+    SocketPoller m_poller;
+    TimerWheel m_timers;
+
+    std::unordered_map<std::uint32_t, std::unique_ptr<Client>> m_clients;
+    std::unordered_map<std::uint32_t, std::unique_ptr<Room>> m_rooms;
+    std::uint32_t m_nextClientId = 1;
+    std::uint32_t m_nextRoomId = 1;
+    std::uint32_t m_waitingClient = 0;
+    std::vector<std::uint32_t> m_droppedClients;
+    std::unordered_map<std::uint64_t, std::uint32_t> m_sessions;   // token -> room
+    std::mt19937_64 m_tokenGenerator;
+    std::unordered_set<std::uint32_t> m_backlogged;     // clients with unsent frames
+    std::unique_ptr<GameJournal> m_journal;
+
+    // Counters for the periodic status line
+    std::uint64_t m_movesRelayed = 0;
+    std::uint64_t m_gamesFinished = 0;
+    std::uint64_t m_gamesResumed = 0;
+    std::uint64_t m_spectators = 0;
+    std::uint64_t m_snapshotsSent = 0;
+
+    void acceptClients();
+    void receiveFrom(Client& client);
+    static Frame makeFrame(const sf::Packet& packet);
+    void send(Client& client, const sf::Packet& packet);
+    void enqueue(Client& client, const Frame& frame, bool droppable);
+    void flush(Client& client);
+    void flushBacklogged();
+    // Clients are dropped at the end of a loop iteration, never in the middle of handling a message
+    void markDropped(Client& client);
+    void processDrops();
+
+    void handleHello(Client& client, sf::Packet& packet);
+    void handleMove(Client& client, sf::Packet& packet);
+    void handlePing(Client& client, sf::Packet& packet, std::int64_t receiveTime);
+    void handlePong(Client& client, sf::Packet& packet, std::int64_t receiveTime);
+
+    void startRoom(Client& white, Client& black);
+    bool restoreRoom(const JournaledRoom& journaled);
+    void addSpectator(Client& client, std::uint32_t roomId);
+    void sendToSpectators(Room& room, const Frame& frame);
+    Frame spectateFrame(Room& room);
+    Frame clockFrame(const Room& room, std::int64_t now) const;
+    void resumeSession(Client& client, Room& room, int side, std::uint32_t lastEventSeq);
+    ResyncMessage buildResync(const Room& room, int side, std::uint32_t lastEventSeq) const;
+    void recordEvent(Room& room, const Board::Move& move);
+    std::uint64_t newSessionToken();
+    void sendClock(Room& room, std::int64_t now);
+    void scheduleFlag(Room& room);
+    void checkFlag(Room& room, std::int64_t now);
+    void finishRoom(Room& room, const GameOverMessage& result);
+    std::int64_t lagAllowance(const Client& client) const;
+    Client* findClient(std::uint32_t clientId);
+
+    static std::uint64_t timerPayload(TimerKind kind, std::uint32_t id, std::uint32_t side = 0);
+    void onTimer(std::uint64_t payload, std::int64_t now);
+};
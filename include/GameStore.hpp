@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+#include "MappedFile.hpp"
+#include "Pdn.hpp"
+#include "Position.hpp"
+
+// Every complete legal move (all hops of a capture) for the side to move, in a canonical
+// order that does not depend on how the game got into the position
+void generateTurns(const Position& position, std::vector<PdnMove>& turns);
+
+// Read-only, memory-mapped game database. Columns are stored one after another:
+//
+//   offsets  u64[games + 1]   start of each game in the moves column
+//   results  u8[games]        PdnResult
+//   moves    u8[]             one byte per move: its index among generateTurns();
+//                             255 escapes a two-byte index for huge move lists
+//   hashes   u64[entries]     sorted position hashes
+//   ids      u32[entries]     game containing each hashed position, ascending per hash
+//
+// Every position reached after a move is indexed once per game. Lookups are a binary
+// search over the mapped hash column, so they touch only a few pages.
+class GameStore {
+public:
+    bool open(const std::string& path);
+    void close();
+
+    std::uint64_t getGameCount() const { return m_gameCount; }
+    std::uint64_t getMoveBytes() const { return m_moveBytes; }
+    std::uint64_t getIndexSize() const { return m_indexSize; }
+
+    PdnResult getResult(std::uint32_t gameId) const;
+    // Decodes a game by replaying its moves from the start position
+    bool getGame(std::uint32_t gameId, PdnGame& game);
+
+    // Games reaching the position (with its side to move), ascending. A match of
+    // Position::hash() is taken as a position match.
+    std::vector<std::uint32_t> findGames(const Position& position, std::size_t limit = SIZE_MAX) const;
+    std::size_t countGames(const Position& position) const;
+
+private:
+    MappedFile m_file;
+    std::uint64_t m_gameCount = 0;
+    std::uint64_t m_moveBytes = 0;
+    std::uint64_t m_indexSize = 0;
+    const std::uint64_t* m_offsets = nullptr;
+    const std::uint8_t* m_results = nullptr;
+    const std::uint8_t* m_moves = nullptr;
+    const std::uint64_t* m_hashes = nullptr;
+    const std::uint32_t* m_ids = nullptr;
+    std::vector<PdnMove> m_turns;
+
+    std::pair<const std::uint64_t*, const std::uint64_t*> findRange(std::uint64_t hash) const;
+};
+
+// Builds a game store from a PDN archive. One thread parses the archive while the
+// workers replay and encode batches of games; the index is then sorted in parallel.
+class GameStoreBuilder {
+public:
+    explicit GameStoreBuilder(unsigned int threads);
+
+    bool build(std::istream& pdn, const std::string& path);
+
+    std::uint64_t getGames() const { return m_games; }
+    std::uint64_t getSkipped() const { return m_skipped; }
+    std::uint64_t getMoves() const { return m_moves; }
+    std::uint64_t getIndexSize() const { return m_indexSize; }
+    std::uint64_t getBytesRead() const { return m_bytesRead; }
+
+private:
+    struct IndexEntry {
+        std::uint64_t hash;
+        std::uint32_t gameId;
+    };
+
+    // Games of one batch, encoded by a worker; game numbers are relative to the batch
+    struct EncodedBatch {
+        std::vector<std::uint8_t> moves;
+        std::vector<std::uint64_t> gameEnds;
+        std::vector<std::uint8_t> results;
+        std::vector<IndexEntry> positions;
+        std::uint64_t skipped = 0;
+        std::string firstError;
+    };
+
+    unsigned int m_threads;
+    std::uint64_t m_games = 0;
+    std::uint64_t m_skipped = 0;
+    std::uint64_t m_moves = 0;
+    std::uint64_t m_indexSize = 0;
+    std::uint64_t m_bytesRead = 0;
+
+    static void encodeBatch(const std::vector<PdnGame>& games, EncodedBatch& batch);
+    void sortIndex(std::vector<IndexEntry>& index) const;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Round-trip time and clock offset estimates for a connection
+struct LatencyStats {
+    double lastRttMs = 0.0;
+    double smoothedRttMs = 0.0;
+    double minRttMs = 0.0;
+    double rttJitterMs = 0.0;
+    double clockOffsetMs = 0.0;  // peer clock minus local clock
+    unsigned int pingsSent = 0;
+    unsigned int pongsReceived = 0;
+};
+
+// Turns ping/pong timestamps into RTT and NTP-style clock offset estimates
+class LatencyEstimator {
+public:
+    void reset();
+    void countPingSent() { m_stats.pingsSent++; }
+    
+    // originTime and receiveTime are local, the peer times are on the peer's clock
+    void addSample(std::int64_t originTime, std::int64_t peerReceiveTime,
+                   std::int64_t peerTransmitTime, std::int64_t receiveTime);
+    
+    const LatencyStats& getStats() const { return m_stats; }
+    
+private:
+    struct ClockSample {
+        double delayMs;
+        double offsetMs;
+    };
+    
+    LatencyStats m_stats;
+    std::array<ClockSample, 8> m_samples;
+    std::size_t m_sampleCount = 0;
+};
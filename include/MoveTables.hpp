@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+// Geometry of the dark squares of a Size x Size board, computed at compile time: for
+// every square and direction the adjacent square, the square beyond it (where a man
+// lands after a jump) and the whole diagonal ray a king can slide along. Squares are
+// numbered row by row from the top, Size / 2 per row, as in Position.hpp for 8x8;
+// -1 means off the board.
+namespace tables {
+
+enum Direction : int { UpLeft = 0, UpRight = 1, DownLeft = 2, DownRight = 3 };
+
+constexpr int DIRECTIONS = 4;
+constexpr std::int8_t NONE = -1;
+
+constexpr int ROW_STEP[DIRECTIONS] = {-1, -1, 1, 1};
+constexpr int COL_STEP[DIRECTIONS] = {-1, 1, -1, 1};
+
+constexpr int opposite(int direction) { return 3 - direction; }
+// Up is towards row 0, the way White's men move
+constexpr bool isUp(int direction) { return direction <= UpRight; }
+
+template <int Size>
+struct Geometry {
+    static_assert(Size % 2 == 0 && Size >= 4 && Size * Size / 2 <= 64, "unsupported board size");
+
+    static constexpr int SIZE = Size;
+    static constexpr int SQUARES = Size * Size / 2;
+    static constexpr int PER_ROW = Size / 2;
+    static constexpr int MAX_RAY = Size - 1;
+
+    // One bit per dark square
+    using Bits = std::conditional_t<SQUARES <= 32, std::uint32_t, std::uint64_t>;
+
+    static constexpr Bits bit(int square) { return Bits(1) << square; }
+    static constexpr int row(int square) { return square / PER_ROW; }
+    static constexpr int col(int square) { return (square % PER_ROW) * 2 + (row(square) % 2 == 0 ? 1 : 0); }
+    static constexpr int squareAt(int row, int col) {
+        return (row < 0 || row >= Size || col < 0 || col >= Size || (row + col) % 2 == 0) ? NONE
+                                                                                         : row * PER_ROW + col / 2;
+    }
+    static constexpr Bits rowMask(int row) { return ((Bits(1) << PER_ROW) - 1) << (row * PER_ROW); }
+};
+
+template <class G>
+struct MoveTables {
+    std::int8_t neighbor[G::SQUARES][DIRECTIONS] = {};
+    std::int8_t jump[G::SQUARES][DIRECTIONS] = {};
+    std::int8_t ray[G::SQUARES][DIRECTIONS][G::MAX_RAY] = {};
+    std::uint8_t rayLength[G::SQUARES][DIRECTIONS] = {};
+    typename G::Bits rayMask[G::SQUARES][DIRECTIONS] = {};
+    // The whole board at once: a square of stepMask[direction][parity] has its neighbor
+    // at square + stepShift[direction][parity], parity being that of its row
+    typename G::Bits stepMask[DIRECTIONS][2] = {};
+    int stepShift[DIRECTIONS][2] = {};
+};
+
+template <class G>
+constexpr MoveTables<G> buildMoveTables() {
+    MoveTables<G> tables;
+    for (int square = 0; square < G::SQUARES; square++) {
+        int row = G::row(square);
+        int col = G::col(square);
+        for (int direction = 0; direction < DIRECTIONS; direction++) {
+            int rowStep = ROW_STEP[direction];
+            int colStep = COL_STEP[direction];
+            tables.neighbor[square][direction] = static_cast<std::int8_t>(G::squareAt(row + rowStep, col + colStep));
+            tables.jump[square][direction] = static_cast<std::int8_t>(G::squareAt(row + 2 * rowStep, col + 2 * colStep));
+            if (tables.neighbor[square][direction] != NONE) {
+                tables.stepMask[direction][row % 2] |= G::bit(square);
+                tables.stepShift[direction][row % 2] = tables.neighbor[square][direction] - square;
+            }
+
+            int length = 0;
+            for (int step = 1; step <= G::MAX_RAY; step++) {
+                int target = G::squareAt(row + step * rowStep, col + step * colStep);
+                tables.ray[square][direction][step - 1] = static_cast<std::int8_t>(target);
+                if (target != NONE) {
+                    tables.rayMask[square][direction] |= G::bit(target);
+                    length = step;
+                }
+            }
+            tables.rayLength[square][direction] = static_cast<std::uint8_t>(length);
+        }
+    }
+    return tables;
+}
+
+template <class G>
+inline constexpr MoveTables<G> MOVES = buildMoveTables<G>();
+
+template <typename Bits>
+constexpr int countBits(Bits bits) {
+    int count = 0;
+    for (; bits; bits &= bits - 1) {
+        count++;
+    }
+    return count;
+}
+
+// Every table agrees with every other one: stepping back undoes a step, a jump is two
+// steps, a ray starts with the neighbor and its mask holds exactly its squares
+template <class G>
+constexpr bool tablesAreConsistent() {
+    const MoveTables<G>& moves = MOVES<G>;
+    int raySquares = 0;
+    for (int square = 0; square < G::SQUARES; square++) {
+        for (int direction = 0; direction < DIRECTIONS; direction++) {
+            int next = moves.neighbor[square][direction];
+            if (next != NONE && moves.neighbor[next][opposite(direction)] != square) {
+                return false;
+            }
+            int beyond = next == NONE ? NONE : moves.neighbor[next][direction];
+            if (moves.jump[square][direction] != beyond) {
+                return false;
+            }
+            bool steps = moves.stepMask[direction][G::row(square) % 2] & G::bit(square);
+            if (steps != (next != NONE) || (steps && square + moves.stepShift[direction][G::row(square) % 2] != next)) {
+                return false;
+            }
+            int length = moves.rayLength[square][direction];
+            if (moves.ray[square][direction][0] != next || countBits(moves.rayMask[square][direction]) != length) {
+                return false;
+            }
+            for (int step = 1; step < length; step++) {
+                if (moves.ray[square][direction][step] != moves.neighbor[moves.ray[square][direction][step - 1]][direction]) {
+                    return false;
+                }
+            }
+            if (length < G::MAX_RAY && moves.ray[square][direction][length] != NONE) {
+                return false;
+            }
+            raySquares += length;
+        }
+    }
+    // Each of the Size - 1 squares of every diagonal sees the others along it:
+    // 2 * sum over diagonals of n * (n - 1), which is Size * (Size - 1) * (2 * Size - 1) / 3
+    return raySquares == G::SIZE * (G::SIZE - 1) * (2 * G::SIZE - 1) / 3;
+}
+
+using Geometry8 = Geometry<8>;
+using Geometry10 = Geometry<10>;
+
+static_assert(MOVES<Geometry8>.neighbor[28][UpRight] == 24 && MOVES<Geometry8>.jump[28][UpRight] == 21,
+              "a1 leads to b2 and c3");
+static_assert(MOVES<Geometry8>.rayLength[28][UpRight] == 7 && MOVES<Geometry8>.ray[28][UpRight][6] == 3,
+              "a1-h8 is the long diagonal");
+static_assert(MOVES<Geometry8>.neighbor[3][UpRight] == NONE && MOVES<Geometry8>.neighbor[3][DownLeft] == 7,
+              "h8 is a corner");
+static_assert(MOVES<Geometry10>.rayLength[45][UpRight] == 9 && MOVES<Geometry10>.ray[45][UpRight][8] == 4,
+              "46-5 is the long diagonal of a 10x10 board");
+static_assert(tablesAreConsistent<Geometry8>(), "8x8 move tables are inconsistent");
+static_assert(tablesAreConsistent<Geometry10>(), "10x10 move tables are inconsistent");
+
+} // namespace tables
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Position.hpp"
+#include "Rules.hpp"
+
+struct NnueAccumulator;
+
+// Small NNUE-style evaluation network for Russian draughts:
+//
+//   128 inputs     piece type (own man, own king, their man, their king) x square, seen
+//                  from each side; Black's view turns the board around
+//   2 x 128        accumulators, side to move first, clamped to [0, 127]
+//   32             hidden units, weights scaled by 64, clamped to [0, 127]
+//   1              output, weights scaled by 64, in hundredths of a man
+//
+// Weights are int16 and come from a versioned file (see load). Inference uses AVX2 or
+// SSE2 when the compiler targets them and plain loops otherwise; all three give
+// identical results.
+class Network {
+public:
+    static constexpr int INPUTS = 128;
+    static constexpr int HIDDEN = 128;
+    static constexpr int OUTPUTS1 = 32;
+    static constexpr int ACTIVATION_MAX = 127;
+    static constexpr int WEIGHT_SHIFT = 6;
+
+    // File layout, little-endian: "CKNN", u32 version, u32 inputs, hidden, outputs1, then
+    // feature weights [inputs][hidden], feature biases [hidden], hidden weights
+    // [outputs1][2 * hidden], hidden biases i32 [outputs1], output weights [outputs1]
+    // and the output bias i32
+    static constexpr std::uint32_t FILE_VERSION = 1;
+
+    // All weights zero until a network is loaded
+    Network();
+
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    void refresh(const Position& position, NnueAccumulator& accumulator) const;
+    // Same contract as Evaluator::update: after is before with the hop applied
+    void update(NnueAccumulator& accumulator, const Position& before, const Hop& hop, const Position& after) const;
+
+    // Score for the side to move
+    int evaluate(const Position& position, const NnueAccumulator& accumulator) const;
+    int evaluate(const Position& position) const;
+
+    // Direct access to the weights, for training tools
+    std::vector<std::int16_t>& featureWeights() { return m_featureWeights; }
+    std::vector<std::int16_t>& featureBiases() { return m_featureBiases; }
+    std::vector<std::int16_t>& hiddenWeights() { return m_hiddenWeights; }
+    std::vector<std::int32_t>& hiddenBiases() { return m_hiddenBiases; }
+    std::vector<std::int16_t>& outputWeights() { return m_outputWeights; }
+    std::int32_t& outputBias() { return m_outputBias; }
+
+private:
+    std::vector<std::int16_t> m_featureWeights;
+    std::vector<std::int16_t> m_featureBiases;
+    std::vector<std::int16_t> m_hiddenWeights;
+    std::vector<std::int32_t> m_hiddenBiases;
+    std::vector<std::int16_t> m_outputWeights;
+    std::int32_t m_outputBias = 0;
+
+    // Feature index of a piece as seen by White (0) or Black (1)
+    static int feature(int view, const Position& position, int square);
+    void addFeature(NnueAccumulator& accumulator, const Position& position, int square) const;
+    void removeFeature(NnueAccumulator& accumulator, const Position& position, int square) const;
+};
+
+// First-layer sums for both points of view, White's and Black's. Updated per hop by
+// adding and subtracting weight rows rather than recomputed at every node.
+struct NnueAccumulator {
+    alignas(32) std::array<std::array<std::int16_t, Network::HIDDEN>, 2> values;
+};
@@ -1,19 +1,24 @@
 #pragma once
 
 #include <SFML/Network.hpp>
+#include <cstdint>
 #include <functional>
 #include <thread>
 #include <mutex>
 #include <atomic>
 #include <queue>
 #include <string>
+#include <vector>
+#include "LatencyEstimator.hpp"
+#include "Protocol.hpp"
 
 // Enum to track network status
 enum class NetworkStatus {
     Disconnected,
     Hosting,
     Connecting,
-    Connected
+    Connected,
+    Reconnecting    // lost the server, trying to resume the game
 };
 
 // Move data structure to be sent over network
@@ -35,6 +40,8 @@ public:
     
     // Client functions
     bool connectToGame(const std::string& ip, unsigned short port = 50001);
+    // Watches a game on a server; room 0 is the newest game
+    bool watchGame(const std::string& ip, unsigned short port, std::uint32_t roomId);
     void disconnect();
     
     // Send and receive moves
@@ -47,6 +54,17 @@ public:
     std::string getStatusText() const;
     std::string getLocalIpAddress() const;
     
+    // Messages that only a game server sends
+    bool takeGameStart(GameStartMessage& message);
+    bool getClock(ClockMessage& clock, std::int64_t& receivedAt) const;
+    bool takeGameOver(GameOverMessage& message);
+    bool takeResync(ResyncMessage& message);
+    bool takeSpectate(SpectateMessage& message);
+    
+    // Latency tracking
+    LatencyStats getLatencyStats() const;
+    std::string getMetricsText() const;
+    
 private:
     // Network components
     sf::TcpListener m_listener;
@@ -54,17 +72,61 @@ private:
     std::thread m_listenThread;
     std::thread m_receiveThread;
     
-    // Status tracking
-    NetworkStatus m_status;
+    // Status tracking (written by the network threads)
+    std::atomic<NetworkStatus> m_status;
     std::string m_statusMessage;
+    mutable std::mutex m_statusMutex;
     std::atomic<bool> m_running;
     
     // Thread-safe move queue
     std::queue<NetworkMove> m_receivedMoves;
     std::mutex m_movesMutex;
     
+    // Where to reconnect to, and the session that lets a server game be resumed
+    std::string m_remoteIp;
+    unsigned short m_remotePort = 0;
+    std::uint64_t m_sessionToken = 0;
+    std::atomic<std::uint32_t> m_eventCount;   // moves of the current game sent or received
+    bool m_spectating = false;
+    std::uint32_t m_watchRoomId = 0;
+    
+    // Latest server messages
+    bool m_hasGameStart = false;
+    GameStartMessage m_gameStart;
+    bool m_hasClock = false;
+    ClockMessage m_clock;
+    std::int64_t m_clockReceivedAt = 0;
+    bool m_hasGameOver = false;
+    GameOverMessage m_gameOver;
+    bool m_hasResync = false;
+    ResyncMessage m_resync;
+    bool m_hasSpectate = false;
+    SpectateMessage m_spectate;
+    mutable std::mutex m_serverMutex;
+    
+    // Sends come from both the game thread and the receive thread. Framed packets the
+    // socket has not taken yet wait in the outbox, so none is ever cut short.
+    std::mutex m_sendMutex;
+    std::vector<std::uint8_t> m_outbox;
+    
+    // Ping/pong state
+    std::uint32_t m_nextPingSequence = 0;
+    std::int64_t m_lastPingTime = 0;
+    LatencyEstimator m_latency;
+    mutable std::mutex m_latencyMutex;
+    
     // Private methods
     void listenForConnections();
+    bool openConnection(const std::string& ip, unsigned short port);
     void receiveData();
+    bool resumeSession(sf::SocketSelector& selector);
+    bool sendHello();
     void updateStatus(NetworkStatus status, const std::string& message = "");
+    // Queues the packet and sends what the socket takes; false once the connection is lost
+    bool sendPacket(sf::Packet& packet);
+    // Sends queued bytes; call with m_sendMutex held
+    bool flushOutbox();
+    void sendPing(std::int64_t now);
+    void handlePing(sf::Packet& packet, std::int64_t receiveTime);
+    void handlePong(sf::Packet& packet, std::int64_t receiveTime);
 }; 
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Position.hpp"
+
+// One move as the path of squares (see Position.hpp) the piece visits; a capture lists
+// every landing square
+struct PdnMove {
+    std::array<std::uint8_t, 16> squares{};
+    std::uint8_t count = 0;
+    bool capture = false;
+};
+
+enum class PdnResult { Unknown, WhiteWins, BlackWins, Draw };
+
+struct PdnGame {
+    std::vector<std::pair<std::string, std::string>> tags;
+    std::vector<PdnMove> moves;
+    // Movetext written after the move with the same index, such as NAGs and {comments};
+    // empty, or one per move. The reader skips annotations, so it never fills this in.
+    std::vector<std::string> annotations;
+    PdnResult result = PdnResult::Unknown;
+    std::string error;      // why the game failed to parse or validate; empty if it is fine
+
+    // Start position and side to move (from the FEN tag, the initial position otherwise)
+    Position start;
+
+    void clear();
+    const std::string* getTag(const std::string& name) const;
+    void setTag(const std::string& name, const std::string& value);
+};
+
+// Reads games one at a time through a fixed-size buffer, so archives of any size are
+// processed in bounded memory. With validation on, every move is replayed on a board:
+// illegal moves are reported in the game's error, and shorthand captures that give
+// only the first and last square are expanded to their full path.
+class PdnReader {
+public:
+    explicit PdnReader(std::istream& input, std::size_t bufferSize = 64 * 1024);
+
+    void setValidate(bool validate) { m_validate = validate; }
+
+    // Reads the next game; returns false at the end of the input. A game that fails to
+    // parse or validate is still returned, with its error set.
+    bool next(PdnGame& game);
+
+    std::uint64_t getGamesRead() const { return m_gamesRead; }
+    std::uint64_t getBytesRead() const { return m_bytesRead; }
+
+private:
+    std::istream& m_input;
+    std::vector<char> m_buffer;
+    std::size_t m_position = 0;
+    std::size_t m_end = 0;
+    bool m_validate = true;
+    std::uint64_t m_gamesRead = 0;
+    std::uint64_t m_bytesRead = 0;
+    // The last token: a view into the buffer, or into m_spill when it crossed a refill
+    std::string_view m_token;
+    std::string m_spill;
+
+    // Reads the next block of input; false at its end
+    bool refill();
+    int peek();
+    int get();
+    void skipLine();
+    void skipComment();
+    void skipVariation();
+    void skipSpace();
+    void readToken();
+    void readTag(PdnGame& game);
+    bool parseMoveToken(PdnGame& game, std::size_t start);
+    void validate(PdnGame& game);
+};
+
+class PdnWriter {
+public:
+    explicit PdnWriter(std::ostream& output);
+
+    // Writes tags, movetext in algebraic notation and the result, followed by a blank line
+    void write(const PdnGame& game);
+
+    std::uint64_t getGamesWritten() const { return m_gamesWritten; }
+
+private:
+    std::ostream& m_output;
+    std::uint64_t m_gamesWritten = 0;
+    std::string m_line;
+};
+
+const char* pdnResultText(PdnResult result);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <future>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include "Board.hpp"
+#include "Engine.hpp"
+
+// Supplies moves for a side when nobody is clicking on the board (headless play, bots)
+class PlayerController {
+public:
+    virtual ~PlayerController() = default;
+    
+    // Picks the next move for the given color; returns false if there is none
+    virtual bool chooseMove(Board& board, PieceColor color, Board::Move& move) = 0;
+    
+    // Called after our turn in a network game, while the opponent thinks; a controller
+    // may use the time to think ahead. Thinking ends when stopPondering is called or the
+    // next move is chosen.
+    virtual void startPondering(const Board&, PieceColor) {}
+    virtual void stopPondering() {}
+};
+
+// Plays a uniformly random legal move
+class RandomController : public PlayerController {
+public:
+    explicit RandomController(unsigned int seed);
+    bool chooseMove(Board& board, PieceColor color, Board::Move& move) override;
+    
+private:
+    std::mt19937 m_rng;
+};
+
+// Replays moves from a text file, one "fromRow fromCol toRow toCol" per line
+class ScriptController : public PlayerController {
+public:
+    explicit ScriptController(const std::string& path);
+    bool chooseMove(Board& board, PieceColor color, Board::Move& move) override;
+    
+private:
+    std::queue<Board::Move> m_moves;
+};
+
+// Plays the engine's best move. While the opponent thinks it searches the position after
+// their expected reply; when that reply comes the search is already under way (or done)
+// and otherwise the transposition table still holds most of the work.
+class EngineController : public PlayerController {
+public:
+    explicit EngineController(const SearchLimits& limits, std::size_t hashMegabytes = 16);
+    ~EngineController() override;
+    
+    void setPondering(bool enabled) { m_ponderEnabled = enabled; }
+    Engine& getEngine() { return m_engine; }
+    
+    bool chooseMove(Board& board, PieceColor color, Board::Move& move) override;
+    void startPondering(const Board& board, PieceColor opponent) override;
+    void stopPondering() override;
+    
+    std::uint64_t getPonderHits() const { return m_ponderHits; }
+    std::uint64_t getPonderMisses() const { return m_ponderMisses; }
+    
+private:
+    Engine m_engine;
+    SearchLimits m_limits;
+    bool m_ponderEnabled = true;
+    
+    // The turn being played, one hop per call; m_turnPosition is the position the next
+    // hop is played from, and after the last one the position the reply is expected in
+    std::vector<Hop> m_turn;
+    std::vector<Hop> m_reply;
+    std::size_t m_nextHop = 0;
+    Position m_turnPosition;
+    
+    std::future<SearchResult> m_ponder;
+    Position m_ponderPosition;
+    std::chrono::steady_clock::time_point m_ponderStart;
+    std::uint64_t m_ponderHits = 0;
+    std::uint64_t m_ponderMisses = 0;
+    
+    // Ends pondering and returns the search result for the position the opponent left
+    SearchResult searchAfterPondering(const Position& position);
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "MoveTables.hpp"
+#include "Piece.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Dark squares are numbered 0-31 row by row from the top (Black's side); a1, in
+// White's bottom-left corner, is square 28. Numeric notation is the index plus one.
+// The numbering is tables::Geometry8's; squareIndex gives -1 for a light square.
+inline int squareIndex(int row, int col) { return tables::Geometry8::squareAt(row, col); }
+inline int squareRow(int square) { return tables::Geometry8::row(square); }
+inline int squareCol(int square) { return tables::Geometry8::col(square); }
+
+// Algebraic name such as "c3"
+std::string squareName(int square);
+// Accepts "c3" or a number 1-32; returns -1 for anything else
+int parseSquare(const char* text, std::size_t length);
+
+// Index of the lowest set bit; bits must not be zero
+inline int lowestSquare(std::uint32_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+
+// Index of the highest set bit; bits must not be zero
+inline int highestSquare(std::uint32_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, bits);
+    return static_cast<int>(index);
+#else
+    return 31 - __builtin_clz(bits);
+#endif
+}
+
+// 64-bit versions for boards with more than 32 dark squares
+inline int lowestSquare(std::uint64_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+inline int highestSquare(std::uint64_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(bits);
+#endif
+}
+
+// A whole game state in 16 bytes: one bit per dark square for each side and for kings.
+// Used wherever positions are stored or sent: resync messages, archives and indexes.
+struct Position {
+    std::uint32_t white = 0;
+    std::uint32_t black = 0;
+    std::uint32_t kings = 0;
+    std::uint8_t blackToMove = 0;
+    std::int8_t chainSquare = -1;   // piece that has to continue a multi-capture
+
+    // The start position, as EngineRules::initial()
+    static Position initial();
+
+    PieceColor getSideToMove() const { return blackToMove ? PieceColor::Black : PieceColor::White; }
+    void setSideToMove(PieceColor color) { blackToMove = color == PieceColor::Black ? 1 : 0; }
+    std::uint32_t getPieces(PieceColor color) const { return color == PieceColor::White ? white : black; }
+    std::uint32_t getOccupied() const { return white | black; }
+
+    // Zobrist hash over pieces and side to move (not the chain square); stable across
+    // builds and platforms, so it can be stored in files
+    std::uint64_t hash() const;
+
+    // FEN as used by PDN: "W:W21,22,K30:B1-12" gives the side to move, then each side's
+    // pieces, K marking kings; ranges are allowed and squares may be numeric or
+    // algebraic. toFen writes algebraic squares. The chain square is not part of FEN.
+    static bool fromFen(const std::string& text, Position& position);
+    std::string toFen() const;
+
+    bool operator==(const Position& other) const {
+        return white == other.white && black == other.black && kings == other.kings &&
+               blackToMove == other.blackToMove && chainSquare == other.chainSquare;
+    }
+    bool operator!=(const Position& other) const { return !(*this == other); }
+};
+
+static_assert(sizeof(Position) <= 16, "Position must stay within 16 bytes");
+
+// Game state for 10x10 boards, squares numbered the same way (1-50 in notation).
+// Captured pieces stay on the board, marked, until the capturing move ends.
+struct Position10 {
+    std::uint64_t white = 0;
+    std::uint64_t black = 0;
+    std::uint64_t kings = 0;
+    std::uint64_t captured = 0;
+    std::uint8_t blackToMove = 0;
+    std::int8_t chainSquare = -1;
+
+    PieceColor getSideToMove() const { return blackToMove ? PieceColor::Black : PieceColor::White; }
+    void setSideToMove(PieceColor color) { blackToMove = color == PieceColor::Black ? 1 : 0; }
+    std::uint64_t getPieces(PieceColor color) const { return color == PieceColor::White ? white : black; }
+    std::uint64_t getOccupied() const { return white | black; }
+
+    bool operator==(const Position10& other) const {
+        return white == other.white && black == other.black && kings == other.kings &&
+               captured == other.captured && blackToMove == other.blackToMove && chainSquare == other.chainSquare;
+    }
+    bool operator!=(const Position10& other) const { return !(*this == other); }
+};
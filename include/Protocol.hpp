@@ -0,0 +1,109 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "Board.hpp"
+#include "GameClock.hpp"
+#include "Position.hpp"
+
+// Every packet starts with its message type
+enum class MessageType : std::uint8_t {
+    Move = 1,
+    Ping = 2,
+    Pong = 3,
+    GameStart = 4,      // server -> client
+    ClockUpdate = 5,    // server -> client
+    GameOver = 6,       // server -> client
+    Hello = 7,          // client -> server, first message on every connection
+    Resync = 8,         // server -> client, answers a Hello that resumes a game
+    Spectate = 9        // server -> spectator, the position to follow moves from
+};
+
+enum class GameOverReason : std::uint8_t {
+    NoMoves = 0,
+    Timeout = 1,
+    Disconnect = 2,
+    MoveLimit = 3,
+    Abandoned = 4       // the game to resume no longer exists
+};
+
+// Opens a connection to a server. A non-zero token resumes that session's game;
+// lastEventSeq is the number of moves of that game the client has already applied.
+// Spectators name the room to watch, 0 for the newest game.
+struct HelloMessage {
+    std::uint64_t sessionToken = 0;
+    std::uint32_t lastEventSeq = 0;
+    bool spectate = false;
+    std::uint32_t roomId = 0;
+};
+
+// A server assigned the client its side
+struct GameStartMessage {
+    PieceColor color;
+    TimeControl timeControl;
+    std::uint64_t sessionToken = 0;
+    std::uint32_t roomId = 0;
+};
+
+// Brings a reconnected client up to date: the position after event baseSeq, followed
+// by the moves the client missed since then
+struct ResyncMessage {
+    PieceColor color;
+    TimeControl timeControl;
+    std::uint64_t sessionToken = 0;
+    std::uint32_t baseSeq = 0;
+    Position position;
+    std::int32_t moveCount = 0;
+    std::vector<Board::Move> moves;
+};
+
+// Where a spectator picks up a game. Sent when watching starts and again, in place
+// of the moves in between, whenever the spectator fell too far behind.
+struct SpectateMessage {
+    std::uint32_t roomId = 0;
+    TimeControl timeControl;
+    std::uint32_t eventSeq = 0;
+    Position position;
+    std::int32_t moveCount = 0;
+};
+
+// Remaining time of both sides when a turn ended
+struct ClockMessage {
+    std::int64_t whiteMicros;
+    std::int64_t blackMicros;
+    PieceColor sideToMove;
+};
+
+struct GameOverMessage {
+    bool draw;
+    PieceColor winner;
+    GameOverReason reason;
+};
+
+// Payload serialization; the message type byte is written by the sender
+sf::Packet& operator<<(sf::Packet& packet, const HelloMessage& message);
+sf::Packet& operator>>(sf::Packet& packet, HelloMessage& message);
+sf::Packet& operator<<(sf::Packet& packet, const GameStartMessage& message);
+sf::Packet& operator>>(sf::Packet& packet, GameStartMessage& message);
+sf::Packet& operator<<(sf::Packet& packet, const ClockMessage& message);
+sf::Packet& operator>>(sf::Packet& packet, ClockMessage& message);
+sf::Packet& operator<<(sf::Packet& packet, const GameOverMessage& message);
+sf::Packet& operator>>(sf::Packet& packet, GameOverMessage& message);
+sf::Packet& operator<<(sf::Packet& packet, const ResyncMessage& message);
+sf::Packet& operator>>(sf::Packet& packet, ResyncMessage& message);
+sf::Packet& operator<<(sf::Packet& packet, const SpectateMessage& message);
+sf::Packet& operator>>(sf::Packet& packet, SpectateMessage& message);
+
+// How often each side of a connection pings the other
+constexpr std::int64_t PING_INTERVAL_MICROS = 1000000;
+
+// How long a server keeps a dropped player's seat, and a client keeps trying to reclaim it
+constexpr std::int64_t RESUME_WINDOW_MICROS = 30000000;
+
+// Monotonic timestamp used in ping/pong frames
+inline std::int64_t monotonicMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
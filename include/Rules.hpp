@@ -0,0 +1,424 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "MoveTables.hpp"
+#include "Position.hpp"
+
+// One step of a move: a plain move, or a single jump of a multi-capture
+struct Hop {
+    std::int8_t from;
+    std::int8_t to;
+    std::int8_t captured;   // -1 for a plain move
+};
+
+// Rule sets, as compile-time traits. All of them share forced capture, men moving one
+// square forward and a capture continuing while the same piece can capture again.
+namespace variants {
+
+// Russian draughts, the game this client plays: flying kings, men capture backwards
+// too, and a man crowned mid-capture carries on as a king. Captured pieces leave the
+// board at once.
+struct Russian {
+    using Geometry = tables::Geometry8;
+    using Position = ::Position;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr bool CROWN_MID_CAPTURE = true;
+    static constexpr bool MAXIMUM_CAPTURE = false;
+    static constexpr bool REMOVE_AFTER_MOVE = false;
+};
+
+// English checkers: kings move and capture one square at a time, men only capture
+// forwards, and reaching the far row ends the move
+struct English {
+    using Geometry = tables::Geometry8;
+    using Position = ::Position;
+    static constexpr bool FLYING_KINGS = false;
+    static constexpr bool MEN_CAPTURE_BACKWARD = false;
+    static constexpr bool CROWN_MID_CAPTURE = false;
+    static constexpr bool MAXIMUM_CAPTURE = false;
+    static constexpr bool REMOVE_AFTER_MOVE = false;
+};
+
+// International draughts on 10x10: flying kings, the capture taking the most pieces is
+// compulsory, captured pieces are removed once the move ends (and cannot be jumped
+// twice), and a man is only crowned if the move ends on the far row
+struct International {
+    using Geometry = tables::Geometry10;
+    using Position = Position10;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr bool CROWN_MID_CAPTURE = false;
+    static constexpr bool MAXIMUM_CAPTURE = true;
+    static constexpr bool REMOVE_AFTER_MOVE = true;
+};
+
+} // namespace variants
+
+// The rules of a variant on its packed position, as table lookups and bit masks. Each
+// variant gets its own copy of the code with the rule checks resolved at compile time.
+template <class Variant>
+struct Rules {
+    using Geometry = typename Variant::Geometry;
+    using Position = typename Variant::Position;
+    using Bits = typename Geometry::Bits;
+
+    // White's men are crowned on the top row, Black's on the bottom row
+    static constexpr Bits WHITE_PROMOTION = Geometry::rowMask(0);
+    static constexpr Bits BLACK_PROMOTION = Geometry::rowMask(Geometry::SIZE - 1);
+
+    // Both sides' men on all but the two middle rows, White to move
+    static Position initial();
+
+    // Whether from-to is a legal step for the piece on from, ignoring whether some other
+    // piece has to capture (or, where it applies, capture more). Fills in the captured square.
+    static bool findHop(const Position& position, int from, int to, Hop& hop);
+
+    static bool canCapture(const Position& position, int square);
+    static bool canMove(const Position& position, int square);
+    static bool hasCapture(const Position& position, PieceColor color);
+
+    // Every legal hop for the color: only captures when one is available, and only the
+    // capturing piece's while a multi-capture is under way
+    static void generateHops(const Position& position, PieceColor color, std::vector<Hop>& hops);
+
+    // Plays a hop from findHop or generateHops. Returns true if the same piece has to
+    // capture again (chainSquare is set); otherwise the turn passes to the other side.
+    static bool applyHop(Position& position, const Hop& hop);
+
+private:
+    static constexpr const tables::MoveTables<Geometry>& MOVES = tables::MOVES<Geometry>;
+
+    static constexpr Bits bit(int square) { return Geometry::bit(square); }
+    static constexpr std::int8_t narrow(int square) { return static_cast<std::int8_t>(square); }
+
+    // The first occupied square along a ray is the one closest to its start
+    static int nearest(Bits blockers, int direction) {
+        return tables::isUp(direction) ? highestSquare(blockers) : lowestSquare(blockers);
+    }
+
+    static bool isForward(int direction, PieceColor color) {
+        return tables::isUp(direction) == (color == PieceColor::White);
+    }
+
+    // The neighbors in a direction of every square of a set
+    static Bits step(Bits squares, int direction) {
+        Bits neighbors = 0;
+        for (int parity = 0; parity < 2; parity++) {
+            Bits from = squares & MOVES.stepMask[direction][parity];
+            int shift = MOVES.stepShift[direction][parity];
+            neighbors |= shift >= 0 ? from << shift : from >> -shift;
+        }
+        return neighbors;
+    }
+
+    static PieceColor colorAt(const Position& position, int square) {
+        return (position.white & bit(square)) ? PieceColor::White : PieceColor::Black;
+    }
+
+    // Opposing pieces that may still be jumped this move
+    static Bits capturable(const Position& position, PieceColor color) {
+        Bits pieces = color == PieceColor::White ? position.black : position.white;
+        if constexpr (Variant::REMOVE_AFTER_MOVE) {
+            pieces &= ~position.captured;
+        }
+        return pieces;
+    }
+
+    static bool isShortMover(const Position& position, int square) {
+        return !Variant::FLYING_KINGS || !(position.kings & bit(square));
+    }
+
+    static bool canJump(const Position& position, int square, int direction) {
+        return Variant::MEN_CAPTURE_BACKWARD || (position.kings & bit(square)) ||
+               isForward(direction, colorAt(position, square));
+    }
+
+    static int directionTo(int from, int to);
+    static void addCaptures(const Position& position, int square, std::vector<Hop>& hops);
+    static void addMoves(const Position& position, int square, std::vector<Hop>& hops);
+    // Most pieces the chain piece can still take this move
+    static int longestCapture(const Position& position);
+};
+
+template <class Variant>
+typename Rules<Variant>::Position Rules<Variant>::initial() {
+    Position position;
+    for (int row = 0; row < (Geometry::SIZE - 2) / 2; row++) {
+        position.black |= Geometry::rowMask(row);
+        position.white |= Geometry::rowMask(Geometry::SIZE - 1 - row);
+    }
+    return position;
+}
+
+template <class Variant>
+int Rules<Variant>::directionTo(int from, int to) {
+    for (int direction = 0; direction < tables::DIRECTIONS; direction++) {
+        if (MOVES.rayMask[from][direction] & bit(to)) {
+            return direction;
+        }
+    }
+    return -1;
+}
+
+template <class Variant>
+void Rules<Variant>::addCaptures(const Position& position, int square, std::vector<Hop>& hops) {
+    Bits occupied = position.getOccupied();
+    Bits enemies = capturable(position, colorAt(position, square));
+    for (int direction = 0; direction < tables::DIRECTIONS; direction++) {
+        if (isShortMover(position, square)) {
+            int over = MOVES.neighbor[square][direction];
+            int landing = MOVES.jump[square][direction];
+            if (landing != tables::NONE && (enemies & bit(over)) && !(occupied & bit(landing)) &&
+                canJump(position, square, direction)) {
+                hops.push_back({narrow(square), narrow(landing), narrow(over)});
+            }
+            continue;
+        }
+
+        Bits blockers = MOVES.rayMask[square][direction] & occupied;
+        if (!blockers) {
+            continue;
+        }
+        int over = nearest(blockers, direction);
+        if (!(enemies & bit(over))) {
+            continue;
+        }
+        // Any empty square past the captured piece, up to the next piece
+        for (int landing = MOVES.neighbor[over][direction]; landing != tables::NONE && !(occupied & bit(landing));
+             landing = MOVES.neighbor[landing][direction]) {
+            hops.push_back({narrow(square), narrow(landing), narrow(over)});
+        }
+    }
+}
+
+template <class Variant>
+void Rules<Variant>::addMoves(const Position& position, int square, std::vector<Hop>& hops) {
+    Bits occupied = position.getOccupied();
+    bool king = position.kings & bit(square);
+    PieceColor color = colorAt(position, square);
+    for (int direction = 0; direction < tables::DIRECTIONS; direction++) {
+        if (isShortMover(position, square)) {
+            int target = MOVES.neighbor[square][direction];
+            if (target != tables::NONE && (king || isForward(direction, color)) && !(occupied & bit(target))) {
+                hops.push_back({narrow(square), narrow(target), -1});
+            }
+            continue;
+        }
+        for (int step = 0; step < MOVES.rayLength[square][direction]; step++) {
+            int target = MOVES.ray[square][direction][step];
+            if (occupied & bit(target)) {
+                break;
+            }
+            hops.push_back({narrow(square), narrow(target), -1});
+        }
+    }
+}
+
+template <class Variant>
+int Rules<Variant>::longestCapture(const Position& position) {
+    std::vector<Hop> hops;
+    addCaptures(position, position.chainSquare, hops);
+    int longest = 0;
+    for (const Hop& hop : hops) {
+        Position next = position;
+        longest = std::max(longest, 1 + (applyHop(next, hop) ? longestCapture(next) : 0));
+    }
+    return longest;
+}
+
+template <class Variant>
+bool Rules<Variant>::findHop(const Position& position, int from, int to, Hop& hop) {
+    if (from < 0 || from >= Geometry::SQUARES || to < 0 || to >= Geometry::SQUARES) {
+        return false;
+    }
+    Bits occupied = position.getOccupied();
+    if (!(occupied & bit(from)) || (occupied & bit(to))) {
+        return false;
+    }
+    int direction = directionTo(from, to);
+    if (direction < 0) {
+        return false;
+    }
+
+    PieceColor color = colorAt(position, from);
+    Bits enemies = capturable(position, color);
+    hop = {narrow(from), narrow(to), -1};
+    if (isShortMover(position, from)) {
+        // Men step forward, kings either way; both jump an adjacent enemy
+        if (to == MOVES.neighbor[from][direction]) {
+            return (position.kings & bit(from)) || isForward(direction, color);
+        }
+        int over = MOVES.neighbor[from][direction];
+        if (to == MOVES.jump[from][direction] && (enemies & bit(over)) && canJump(position, from, direction)) {
+            hop.captured = narrow(over);
+            return true;
+        }
+        return false;
+    }
+
+    // Flying kings slide over empty squares and at most one enemy piece
+    Bits between = MOVES.rayMask[from][direction] & ~MOVES.rayMask[to][direction] & ~bit(to);
+    if (between & occupied & ~enemies) {
+        return false;
+    }
+    Bits jumped = between & enemies;
+    if (jumped & (jumped - 1)) {
+        return false;
+    }
+    if (jumped) {
+        hop.captured = narrow(lowestSquare(jumped));
+    }
+    return true;
+}
+
+template <class Variant>
+bool Rules<Variant>::canCapture(const Position& position, int square) {
+    Bits occupied = position.getOccupied();
+    Bits enemies = capturable(position, colorAt(position, square));
+    for (int direction = 0; direction < tables::DIRECTIONS; direction++) {
+        int over;
+        if (!isShortMover(position, square)) {
+            Bits blockers = MOVES.rayMask[square][direction] & occupied;
+            if (!blockers) {
+                continue;
+            }
+            over = nearest(blockers, direction);
+        } else {
+            over = MOVES.neighbor[square][direction];
+            if (over == tables::NONE || !canJump(position, square, direction)) {
+                continue;
+            }
+        }
+        int landing = MOVES.neighbor[over][direction];
+        if ((enemies & bit(over)) && landing != tables::NONE && !(occupied & bit(landing))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class Variant>
+bool Rules<Variant>::canMove(const Position& position, int square) {
+    Bits occupied = position.getOccupied();
+    bool king = position.kings & bit(square);
+    PieceColor color = colorAt(position, square);
+    for (int direction = 0; direction < tables::DIRECTIONS; direction++) {
+        int target = MOVES.neighbor[square][direction];
+        if (target != tables::NONE && !(occupied & bit(target)) && (king || isForward(direction, color))) {
+            return true;
+        }
+    }
+    return canCapture(position, square);
+}
+
+template <class Variant>
+bool Rules<Variant>::hasCapture(const Position& position, PieceColor color) {
+    // Pieces that jump an adjacent enemy are checked all at once, a direction at a time
+    Bits pieces = position.getPieces(color);
+    Bits shortMovers = Variant::FLYING_KINGS ? pieces & ~position.kings : pieces;
+    Bits enemies = capturable(position, color);
+    Bits empty = ~position.getOccupied();
+    for (int direction = 0; direction < tables::DIRECTIONS; direction++) {
+        Bits jumpers = shortMovers;
+        if (!Variant::MEN_CAPTURE_BACKWARD && !isForward(direction, color)) {
+            jumpers &= position.kings;
+        }
+        if (step(step(jumpers, direction) & enemies, direction) & empty) {
+            return true;
+        }
+    }
+    if constexpr (Variant::FLYING_KINGS) {
+        for (Bits kings = pieces & position.kings; kings; kings &= kings - 1) {
+            if (canCapture(position, lowestSquare(kings))) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+template <class Variant>
+void Rules<Variant>::generateHops(const Position& position, PieceColor color, std::vector<Hop>& hops) {
+    hops.clear();
+    Bits movers = position.getPieces(color);
+    if (position.chainSquare >= 0) {
+        movers &= bit(position.chainSquare);
+    }
+    bool mustCapture = position.chainSquare >= 0 || hasCapture(position, color);
+    for (; movers; movers &= movers - 1) {
+        int square = lowestSquare(movers);
+        if (mustCapture) {
+            addCaptures(position, square, hops);
+        } else {
+            addMoves(position, square, hops);
+        }
+    }
+
+    if constexpr (Variant::MAXIMUM_CAPTURE) {
+        if (!mustCapture || hops.size() < 2) {
+            return;
+        }
+        // Keep only the hops that start one of the longest captures
+        std::vector<int> lengths;
+        lengths.reserve(hops.size());
+        for (const Hop& hop : hops) {
+            Position next = position;
+            lengths.push_back(1 + (applyHop(next, hop) ? longestCapture(next) : 0));
+        }
+        int longest = *std::max_element(lengths.begin(), lengths.end());
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < hops.size(); i++) {
+            if (lengths[i] == longest) {
+                hops[kept++] = hops[i];
+            }
+        }
+        hops.resize(kept);
+    }
+}
+
+template <class Variant>
+bool Rules<Variant>::applyHop(Position& position, const Hop& hop) {
+    Bits fromBit = bit(hop.from);
+    Bits toBit = bit(hop.to);
+    PieceColor color = colorAt(position, hop.from);
+    Bits promotion = color == PieceColor::White ? WHITE_PROMOTION : BLACK_PROMOTION;
+    Bits& own = color == PieceColor::White ? position.white : position.black;
+    own = (own & ~fromBit) | toBit;
+    if (position.kings & fromBit) {
+        position.kings = (position.kings & ~fromBit) | toBit;
+    }
+    if (hop.captured >= 0) {
+        if constexpr (Variant::REMOVE_AFTER_MOVE) {
+            position.captured |= bit(hop.captured);
+        } else {
+            Bits keep = ~bit(hop.captured);
+            position.white &= keep;
+            position.black &= keep;
+            position.kings &= keep;
+        }
+    }
+    if constexpr (Variant::CROWN_MID_CAPTURE) {
+        position.kings |= toBit & promotion;
+    }
+
+    if (hop.captured >= 0 && canCapture(position, hop.to)) {
+        position.chainSquare = narrow(hop.to);
+        return true;
+    }
+    if constexpr (!Variant::CROWN_MID_CAPTURE) {
+        position.kings |= toBit & promotion;
+    }
+    if constexpr (Variant::REMOVE_AFTER_MOVE) {
+        Bits keep = ~position.captured;
+        position.white &= keep;
+        position.black &= keep;
+        position.kings &= keep;
+        position.captured = 0;
+    }
+    position.chainSquare = -1;
+    position.setSideToMove(color == PieceColor::White ? PieceColor::Black : PieceColor::White);
+    return false;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Waits for any of a set of sockets to have something to read. Built on poll()
+// (WSAPoll on Windows) rather than select(), so unlike sf::SocketSelector it holds any
+// number of sockets, not just descriptors below FD_SETSIZE (1024 on most systems).
+class SocketPoller {
+public:
+    SocketPoller();
+    ~SocketPoller();
+    SocketPoller(const SocketPoller&) = delete;
+    SocketPoller& operator=(const SocketPoller&) = delete;
+
+    // Sockets are known by an id the caller picks, which wait() reports back
+    void add(const sf::Socket& socket, std::uint32_t id);
+    void remove(std::uint32_t id);
+    void clear();
+
+    // Waits until a socket is readable or closed, or the timeout passes; returns false
+    // when none is
+    bool wait(std::int64_t timeoutMicros);
+    // The sockets found ready by the last wait
+    const std::vector<std::uint32_t>& getReady() const { return m_ready; }
+
+private:
+    // The platform's descriptor array, kept out of this header
+    struct Descriptors;
+
+    std::unique_ptr<Descriptors> m_descriptors;
+    std::vector<std::uint32_t> m_ready;
+};
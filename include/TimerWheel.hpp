@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel (Varghese & Lauck). Scheduling and cancelling are O(1),
+// and advancing only touches the slots that come due, so one thread can drive the
+// timers of thousands of games.
+class TimerWheel {
+public:
+    using TimerId = std::uint64_t;   // 0 is never a valid timer
+
+    explicit TimerWheel(std::int64_t startMicros, std::int64_t tickMicros = 1000);
+
+    // Schedules a timer that fires once at the given monotonic time
+    TimerId schedule(std::int64_t deadlineMicros, std::uint64_t payload);
+    bool cancel(TimerId id);
+
+    // Fires every timer that is due by now, calling onExpire(payload) for each.
+    // Callbacks may schedule and cancel timers.
+    template <typename Callback>
+    void advance(std::int64_t nowMicros, Callback&& onExpire);
+
+    // Upper bound on how long the caller can sleep without missing a timer
+    std::int64_t microsUntilNextCheck(std::int64_t nowMicros) const;
+    std::size_t size() const { return m_count; }
+
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr std::uint32_t NIL = 0xFFFFFFFF;
+
+    enum class NodeState : std::uint8_t { Free, Linked, Firing };
+
+    struct Node {
+        std::uint64_t expiryTick = 0;
+        std::uint64_t payload = 0;
+        std::uint32_t prev = NIL;
+        std::uint32_t next = NIL;
+        std::uint32_t generation = 1;
+        std::uint16_t slot = 0;          // index into m_slots while linked
+        NodeState state = NodeState::Free;
+    };
+
+    std::int64_t m_startMicros;
+    std::int64_t m_tickMicros;
+    std::uint64_t m_currentTick = 0;
+    std::size_t m_count = 0;
+    std::array<std::uint32_t, LEVELS * SLOTS> m_slots;
+    std::vector<Node> m_nodes;
+    std::vector<std::uint32_t> m_freeNodes;
+    std::vector<std::uint32_t> m_firing;
+
+    std::uint64_t tickFor(std::int64_t micros) const;
+    void link(std::uint32_t index, std::uint64_t earliestTick);
+    void unlink(std::uint32_t index);
+    void release(std::uint32_t index);
+    void cascade(int level);
+};
+
+template <typename Callback>
+void TimerWheel::advance(std::int64_t nowMicros, Callback&& onExpire) {
+    std::uint64_t targetTick = tickFor(nowMicros);
+    if (m_count == 0) {
+        // Nothing to fire, skip straight ahead
+        m_currentTick = std::max(m_currentTick, targetTick);
+        return;
+    }
+
+    while (m_currentTick < targetTick) {
+        m_currentTick++;
+
+        // Pull timers down from the coarser wheels whenever a finer wheel wraps around
+        for (int level = 1; level < LEVELS; level++) {
+            if ((m_currentTick & ((std::uint64_t(1) << (level * SLOT_BITS)) - 1)) != 0) {
+                break;
+            }
+            cascade(level);
+        }
+
+        // Detach the due slot first so callbacks can safely touch the wheel
+        std::uint32_t slot = static_cast<std::uint32_t>(m_currentTick & (SLOTS - 1));
+        m_firing.clear();
+        for (std::uint32_t index = m_slots[slot]; index != NIL; index = m_nodes[index].next) {
+            m_nodes[index].state = NodeState::Firing;
+            m_firing.push_back(index);
+        }
+        m_slots[slot] = NIL;
+
+        for (std::size_t i = 0; i < m_firing.size(); i++) {
+            std::uint32_t index = m_firing[i];
+            // Cancelled by an earlier callback
+            if (m_nodes[index].state != NodeState::Firing) {
+                continue;
+            }
+            std::uint64_t payload = m_nodes[index].payload;
+            release(index);
+            onExpire(payload);
+        }
+
+        if (m_count == 0) {
+            m_currentTick = targetTick;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <vector>
+#include "Evaluator.hpp"
+
+// Labelled positions, one column per evaluation term, so the loss streams through
+// contiguous floats instead of gathering fields out of per-position records
+struct TuningSet {
+    std::array<std::vector<float>, EvalWeights::TERMS> terms;
+    std::vector<float> results;     // final result from White's side: 1, 0.5 or 0
+
+    std::size_t size() const { return results.size(); }
+    void clear();
+};
+
+// Texel-style tuning of the evaluator weights: the evaluation of each position, turned
+// into an expected score by a logistic curve, is fitted to the result of the game it
+// came from. The evaluation is linear in the weights, so a position is just its term
+// counts and the loss and its gradient are a few passes over the columns.
+class Tuner {
+public:
+    using Weights = std::array<double, EvalWeights::TERMS>;
+    // Called after every iteration with the loss so far
+    using Progress = std::function<void(int iteration, double loss, const Weights& weights)>;
+
+    explicit Tuner(unsigned int threads);
+
+    // Adds the positions of every game with a known result, from the given turn on.
+    // Positions where a capture is forced are left out: their evaluation says little
+    // about a game that is about to change. Returns false if the archive cannot be read.
+    bool load(std::istream& pdn, int skipTurns);
+
+    const TuningSet& getPositions() const { return m_positions; }
+    std::uint64_t getGames() const { return m_games; }
+    std::uint64_t getSkippedGames() const { return m_skippedGames; }
+
+    // Mean squared difference between results and expected scores
+    double loss(const Weights& weights, double scale) const;
+    // The logistic scale (expected score 1 / (1 + 10^(-scale * eval / 400))) that fits
+    // the weights best; tuning keeps it fixed so only the weights move
+    double fitScale(const Weights& weights) const;
+    // Adam gradient descent from the given weights. The man weight stays put as the unit.
+    Weights tune(const Weights& start, double scale, int iterations, double rate, const Progress& progress) const;
+
+    static Weights toWeights(const EvalWeights& weights);
+    static EvalWeights fromWeights(const Weights& weights);
+
+private:
+    unsigned int m_threads;
+    TuningSet m_positions;
+    std::uint64_t m_games = 0;
+    std::uint64_t m_skippedGames = 0;
+
+    // Loss and, when gradient is given, its gradient, summed over all threads
+    double evaluate(const Weights& weights, double scale, Weights* gradient) const;
+};
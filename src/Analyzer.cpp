@@ -0,0 +1,186 @@
+#include "../include/Analyzer.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// Consecutive positions one engine searches in a row; shorter runs spread a few long
+// games over more threads, longer ones reuse more of the table
+constexpr std::size_t RUN_POSITIONS = 16;
+// Scores past this are decided games: giving away some of a win still wins
+constexpr int DECIDED = 1000;
+
+// What is kept of each search
+struct PositionResult {
+    int score = 0;
+    std::vector<Hop> turn;
+};
+
+int clampScore(int score) {
+    return std::max(-DECIDED, std::min(score, DECIDED));
+}
+
+bool sameMove(const PdnMove& move, const std::vector<Hop>& turn) {
+    if (turn.empty() || move.count != turn.size() + 1 || move.squares[0] != turn.front().from) {
+        return false;
+    }
+    for (std::size_t i = 0; i < turn.size(); i++) {
+        if (move.squares[i + 1] != turn[i].to) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string turnText(const std::vector<Hop>& turn) {
+    std::string text;
+    for (const Hop& hop : turn) {
+        text += (text.empty() ? squareName(hop.from) : "") + (hop.captured >= 0 ? "x" : "-") + squareName(hop.to);
+    }
+    return text;
+}
+
+// From White's side, in men
+std::string scoreText(int score) {
+    if (score > Engine::WIN - Engine::MAX_PLY) {
+        return "+win";
+    }
+    if (score < -Engine::WIN + Engine::MAX_PLY) {
+        return "-win";
+    }
+    std::ostringstream text;
+    text << std::showpos << std::fixed << std::setprecision(2) << score / 100.0;
+    return text.str();
+}
+
+} // namespace
+
+GameAnalyzer::GameAnalyzer(const AnalysisOptions& options)
+    : m_options(options) {
+    m_options.threads = std::max(1u, m_options.threads);
+}
+
+std::vector<std::vector<MoveAnalysis>> GameAnalyzer::analyze(const std::vector<PdnGame>& games) {
+    m_positions = 0;
+    m_nodes = 0;
+    m_steals = 0;
+    m_skippedGames = 0;
+
+    // The position before every move and the one after the last; none for a bad game
+    std::vector<std::vector<Position>> positions(games.size());
+    for (std::size_t g = 0; g < games.size(); g++) {
+        const PdnGame& game = games[g];
+        bool legal = game.error.empty();
+        Position position = game.start;
+        positions[g].push_back(position);
+        for (std::size_t turn = 0; turn < game.moves.size() && legal; turn++) {
+            const PdnMove& move = game.moves[turn];
+            for (int i = 1; i < move.count && legal; i++) {
+                Hop hop;
+                legal = EngineRules::findHop(position, move.squares[i - 1], move.squares[i], hop);
+                if (legal) {
+                    EngineRules::applyHop(position, hop);
+                }
+            }
+            positions[g].push_back(position);
+        }
+        if (!legal) {
+            positions[g].clear();
+            m_skippedGames++;
+        }
+    }
+
+    // Whole games go to the thread with the least work so far, in runs from the start
+    std::vector<std::size_t> load(m_options.threads, 0);
+    m_queues.clear();
+    for (unsigned int t = 0; t < m_options.threads; t++) {
+        m_queues.push_back(std::make_unique<RunQueue>());
+    }
+    for (std::size_t g = 0; g < games.size(); g++) {
+        std::size_t count = positions[g].size();
+        std::size_t thread = std::min_element(load.begin(), load.end()) - load.begin();
+        load[thread] += count;
+        for (std::size_t first = 0; first < count; first += RUN_POSITIONS) {
+            m_queues[thread]->runs.push_back({g, first, std::min(first + RUN_POSITIONS, count)});
+        }
+    }
+
+    std::vector<std::vector<PositionResult>> results(games.size());
+    for (std::size_t g = 0; g < games.size(); g++) {
+        results[g].resize(positions[g].size());
+    }
+    auto work = [&](unsigned int thread) {
+        Engine engine(m_options.hashMegabytes);
+        Run run;
+        while (takeRun(thread, run)) {
+            for (std::size_t i = run.last; i-- > run.first;) {
+                SearchResult result = engine.search(positions[run.game][i], m_options.limits);
+                results[run.game][i] = {result.score, std::move(result.turn)};
+                m_nodes += result.nodes;
+                m_positions++;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < m_options.threads; t++) {
+        threads.emplace_back(work, t);
+    }
+    work(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // A move is worth the negated score of the position it leads to
+    std::vector<std::vector<MoveAnalysis>> analyses(games.size());
+    for (std::size_t g = 0; g < games.size(); g++) {
+        for (std::size_t i = 0; i + 1 < results[g].size(); i++) {
+            MoveAnalysis move;
+            move.bestScore = results[g][i].score;
+            move.playedScore = -results[g][i + 1].score;
+            move.best = results[g][i].turn;
+            move.blunder = clampScore(move.bestScore) - clampScore(move.playedScore) >= m_options.blunder &&
+                           !sameMove(games[g].moves[i], move.best);
+            analyses[g].push_back(std::move(move));
+        }
+    }
+    return analyses;
+}
+
+bool GameAnalyzer::takeRun(unsigned int thread, Run& run) {
+    {
+        RunQueue& own = *m_queues[thread];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.runs.empty()) {
+            run = own.runs.back();
+            own.runs.pop_back();
+            return true;
+        }
+    }
+    // Nothing is queued once the work starts, so empty queues everywhere mean done
+    for (std::size_t i = 1; i < m_queues.size(); i++) {
+        RunQueue& other = *m_queues[(thread + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.runs.empty()) {
+            run = other.runs.front();
+            other.runs.pop_front();
+            m_steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void GameAnalyzer::annotate(PdnGame& game, const std::vector<MoveAnalysis>& moves) {
+    game.annotations.clear();
+    bool white = game.start.getSideToMove() == PieceColor::White;
+    for (const MoveAnalysis& move : moves) {
+        std::string text = "{" + scoreText(white ? move.playedScore : -move.playedScore);
+        if (move.blunder) {
+            text = "$4 " + text + ", best " + turnText(move.best);
+        }
+        game.annotations.push_back(text + "}");
+        white = !white;
+    }
+}
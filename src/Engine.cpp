@@ -0,0 +1,583 @@
+#include "../include/Engine.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Wins are stored in the table relative to the node, not the root
+int toTable(int score, int ply) {
+    if (score > Engine::WIN - Engine::MAX_PLY) {
+        return score + ply;
+    }
+    if (score < -Engine::WIN + Engine::MAX_PLY) {
+        return score - ply;
+    }
+    return score;
+}
+
+int fromTable(int score, int ply) {
+    if (score > Engine::WIN - Engine::MAX_PLY) {
+        return score - ply;
+    }
+    if (score < -Engine::WIN + Engine::MAX_PLY) {
+        return score + ply;
+    }
+    return score;
+}
+
+bool sameHop(const Hop& hop, int from, int to) {
+    return hop.from == from && hop.to == to;
+}
+
+bool sameTurn(const std::vector<Hop>& a, const std::vector<Hop>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const Hop& x, const Hop& y) { return sameHop(x, y.from, y.to); });
+}
+
+// Legal moves from the position, counting every way through a capture
+std::size_t countTurns(const Position& position) {
+    std::vector<Hop> hops;
+    EngineRules::generateHops(position, position.getSideToMove(), hops);
+    std::size_t turns = 0;
+    for (const Hop& hop : hops) {
+        Position next = position;
+        turns += EngineRules::applyHop(next, hop) ? countTurns(next) : 1;
+    }
+    return turns;
+}
+
+// Ordering scores, in bands that do not overlap: history stays below HISTORY_LIMIT
+constexpr int HASH_SCORE = 1 << 30;
+constexpr int CAPTURE_SCORE = 1 << 24;
+constexpr int CROWN_SCORE = 1 << 23;
+constexpr int KILLER_SCORE = 1 << 22;
+constexpr int HISTORY_LIMIT = 1 << 20;
+
+// Aspiration windows start this wide around the last score and double on each failure
+constexpr int ASPIRATION_WINDOW = 25;
+constexpr int ASPIRATION_DEPTH = 4;
+// Late move reductions: which quiet hops are late, and from what depth
+constexpr std::size_t REDUCTION_HOPS = 3;
+constexpr int REDUCTION_DEPTH = 3;
+// Futility pruning: a quiet hop this close to the leaves cannot make up more than this
+constexpr int FUTILITY_DEPTH = 2;
+constexpr int FUTILITY_MARGIN = 90;
+
+} // namespace
+
+TranspositionTable::TranspositionTable(std::size_t megabytes) {
+    std::size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= std::max<std::size_t>(megabytes, 1) * 1024 * 1024) {
+        count *= 2;
+    }
+    m_entries.resize(count);
+    m_mask = count - 1;
+}
+
+void TranspositionTable::clear() {
+    std::fill(m_entries.begin(), m_entries.end(), Entry());
+}
+
+const TranspositionTable::Entry* TranspositionTable::probe(std::uint64_t key) const {
+    const Entry& entry = m_entries[key & m_mask];
+    return entry.key == key && entry.depth >= 0 ? &entry : nullptr;
+}
+
+void TranspositionTable::store(std::uint64_t key, int score, int depth, Bound bound, const Hop* best) {
+    Entry& entry = m_entries[key & m_mask];
+    if (entry.key == key && depth < entry.depth) {
+        return;
+    }
+    entry.key = key;
+    entry.score = static_cast<std::int16_t>(score);
+    entry.depth = static_cast<std::int8_t>(std::min(depth, 127));
+    entry.bound = bound;
+    entry.from = best ? best->from : -1;
+    entry.to = best ? best->to : -1;
+}
+
+Engine::Engine(std::size_t hashMegabytes)
+    : m_table(hashMegabytes) {
+}
+
+void Engine::clear() {
+    m_table.clear();
+    for (auto& side : m_history) {
+        for (auto& from : side) {
+            from.fill(0);
+        }
+    }
+}
+
+void Engine::ageHistory() {
+    // Older searches count for less but still point the way
+    for (auto& side : m_history) {
+        for (auto& from : side) {
+            for (int& value : from) {
+                value /= 2;
+            }
+        }
+    }
+}
+
+void Engine::scoreHops(const Position& position, int ply, int hashFrom, int hashTo) {
+    const std::vector<Hop>& hops = m_hops[ply];
+    std::vector<int>& scores = m_scores[ply];
+    scores.resize(hops.size());
+    const auto& history = m_history[position.blackToMove ? 1 : 0];
+    const auto promotion = position.blackToMove ? EngineRules::BLACK_PROMOTION : EngineRules::WHITE_PROMOTION;
+    for (std::size_t i = 0; i < hops.size(); i++) {
+        const Hop& hop = hops[i];
+        int score = 0;
+        if (sameHop(hop, hashFrom, hashTo)) {
+            score = HASH_SCORE;
+        } else if (!m_options.ordering) {
+            // Earlier hops first, so picking keeps the generated order
+            score = -static_cast<int>(i);
+        } else if (hop.captured >= 0) {
+            score = CAPTURE_SCORE + ((position.kings & EngineRules::Geometry::bit(hop.captured)) ? 2 : 1);
+        } else if (!(position.kings & EngineRules::Geometry::bit(hop.from)) &&
+                   (promotion & EngineRules::Geometry::bit(hop.to))) {
+            score = CROWN_SCORE;
+        } else if (sameHop(hop, m_killers[ply][0].from, m_killers[ply][0].to)) {
+            score = KILLER_SCORE + 1;
+        } else if (sameHop(hop, m_killers[ply][1].from, m_killers[ply][1].to)) {
+            score = KILLER_SCORE;
+        } else {
+            score = history[hop.from][hop.to];
+        }
+        scores[i] = score;
+    }
+}
+
+const Hop& Engine::pickHop(int ply, std::size_t index) {
+    std::vector<Hop>& hops = m_hops[ply];
+    std::vector<int>& scores = m_scores[ply];
+    std::size_t best = index;
+    for (std::size_t i = index + 1; i < hops.size(); i++) {
+        if (scores[i] > scores[best]) {
+            best = i;
+        }
+    }
+    std::swap(hops[index], hops[best]);
+    std::swap(scores[index], scores[best]);
+    return hops[index];
+}
+
+void Engine::recordCutoff(const Position& position, const Hop& hop, int depth, int ply) {
+    // Captures are ordered first anyway
+    if (hop.captured >= 0 || !m_options.ordering) {
+        return;
+    }
+    std::array<Hop, 2>& killers = m_killers[ply];
+    if (!sameHop(killers[0], hop.from, hop.to)) {
+        killers[1] = killers[0];
+        killers[0] = hop;
+    }
+    int& value = m_history[position.blackToMove ? 1 : 0][hop.from][hop.to];
+    value += depth * depth;
+    if (value >= HISTORY_LIMIT) {
+        ageHistory();
+    }
+}
+
+std::uint64_t Engine::hashKey(const Position& position) {
+    // Mid-capture positions must not share entries with the same pieces at rest
+    std::uint64_t key = position.hash();
+    if (position.chainSquare >= 0) {
+        key ^= 0x9E3779B97F4A7C15ull * static_cast<std::uint64_t>(position.chainSquare + 1);
+    }
+    return key;
+}
+
+int Engine::evaluate(const Position& position, int ply) const {
+    if (m_network) {
+        return m_network->evaluate(position, m_accumulators[ply]);
+    }
+    return m_evaluator.evaluate(position, m_states[ply]);
+}
+
+void Engine::playHop(const Position& before, const Hop& hop, const Position& after, int ply) {
+    if (m_network) {
+        m_accumulators[ply + 1] = m_accumulators[ply];
+        m_network->update(m_accumulators[ply + 1], before, hop, after);
+    } else {
+        m_states[ply + 1] = m_states[ply];
+        m_evaluator.update(m_states[ply + 1], before, hop, after);
+    }
+}
+
+bool Engine::shouldStop() {
+    if (m_stopped) {
+        return true;
+    }
+    // The first iteration always completes, so there is a move to play
+    if (!m_canStop) {
+        return false;
+    }
+    if (m_stopRequested || (m_limits.nodes > 0 && m_nodes >= m_limits.nodes)) {
+        m_stopped = true;
+    } else if (m_limits.milliseconds > 0 && (m_nodes & 1023) == 0 &&
+               Clock::now() - m_start >= std::chrono::milliseconds(m_limits.milliseconds)) {
+        m_stopped = true;
+    }
+    return m_stopped;
+}
+
+SearchResult Engine::search(const Position& position, const SearchLimits& limits) {
+    m_limits = limits;
+    m_start = Clock::now();
+    m_nodes = 0;
+    m_stopped = false;
+    m_canStop = false;
+    for (auto& killers : m_killers) {
+        killers.fill(Hop{-1, -1, -1});
+    }
+    ageHistory();
+    if (m_network) {
+        m_network->refresh(position, m_accumulators[0]);
+    } else {
+        m_states[0] = m_evaluator.computeState(position);
+    }
+
+    std::size_t lineCount = 1;
+    if (limits.lines > 1) {
+        lineCount = std::max<std::size_t>(1, std::min<std::size_t>(limits.lines, countTurns(position)));
+    }
+    m_multiLine = lineCount > 1;
+    m_rootTurn[0] = true;
+
+    SearchResult result;
+    int maxDepth = std::max(1, std::min(limits.depth, MAX_PLY / 2));
+    for (int depth = 1; depth <= maxDepth; depth++) {
+        // Each line leaves out the moves of the lines before it at this depth
+        m_excluded.clear();
+        std::vector<SearchLine> found;
+        for (std::size_t i = 0; i < lineCount; i++) {
+            int score = searchRoot(position, depth, i < result.lines.size() ? result.lines[i].score : 0);
+            if (m_stopped) {
+                break;
+            }
+            // The move is the principal variation up to the end of the first turn
+            SearchLine line;
+            line.pv.assign(m_pv[0].begin(), m_pv[0].begin() + m_pvLength[0]);
+            Position current = position;
+            std::size_t index = 0;
+            line.turn = variationTurn(current, line.pv, index);
+            line.score = score;
+            line.depth = depth;
+            m_excluded.push_back(line.turn);
+
+            // Lines from this depth come first; the ones it has not reached yet follow
+            auto later = std::upper_bound(found.begin(), found.end(), score,
+                                          [](int s, const SearchLine& other) { return s > other.score; });
+            found.insert(later, line);
+            std::vector<SearchLine> lines = found;
+            for (const SearchLine& old : result.lines) {
+                auto same = [&old](const SearchLine& other) { return sameTurn(old.turn, other.turn); };
+                if (lines.size() < lineCount && std::none_of(found.begin(), found.end(), same)) {
+                    lines.push_back(old);
+                }
+            }
+            result.lines = std::move(lines);
+
+            const SearchLine& best = result.lines.front();
+            result.score = best.score;
+            result.depth = best.depth;
+            result.pv = best.pv;
+            current = position;
+            index = 0;
+            result.turn = variationTurn(current, result.pv, index);
+            result.reply = variationTurn(current, result.pv, index);
+            if (m_progress) {
+                result.nodes = m_nodes;
+                result.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - m_start).count();
+                m_progress(result);
+            }
+        }
+        if (m_stopped) {
+            break;
+        }
+        m_canStop = true;
+        // Deeper searches cannot change a forced result
+        bool decided = std::all_of(result.lines.begin(), result.lines.end(),
+                                   [](const SearchLine& line) { return std::abs(line.score) > WIN - MAX_PLY; });
+        if (decided) {
+            break;
+        }
+    }
+    result.nodes = m_nodes;
+    result.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - m_start).count();
+    return result;
+}
+
+Hop Engine::bestStoredHop(const Position& position) {
+    std::vector<Hop> hops;
+    EngineRules::generateHops(position, position.getSideToMove(), hops);
+    const TranspositionTable::Entry* entry = m_table.probe(hashKey(position));
+    for (const Hop& hop : hops) {
+        if (entry && sameHop(hop, entry->from, entry->to)) {
+            return hop;
+        }
+    }
+    return hops.front();
+}
+
+std::vector<Hop> Engine::variationTurn(Position& position, const std::vector<Hop>& pv, std::size_t& index) {
+    std::vector<Hop> turn;
+    bool sameSide = true;
+    for (; index < pv.size() && sameSide; index++) {
+        turn.push_back(pv[index]);
+        sameSide = EngineRules::applyHop(position, pv[index]);
+    }
+    // A table hit can cut the variation short in the middle of a capture; what follows
+    // in the variation no longer applies once it is completed from the table
+    while (sameSide && !turn.empty()) {
+        turn.push_back(bestStoredHop(position));
+        sameSide = EngineRules::applyHop(position, turn.back());
+        index = pv.size();
+    }
+    return turn;
+}
+
+bool Engine::isExcluded(const Hop& hop, int ply) const {
+    for (const std::vector<Hop>& turn : m_excluded) {
+        if (static_cast<int>(turn.size()) != ply + 1 || !sameHop(turn.back(), hop.from, hop.to)) {
+            continue;
+        }
+        bool same = true;
+        for (int i = 0; i < ply && same; i++) {
+            same = sameHop(turn[i], m_path[i].from, m_path[i].to);
+        }
+        if (same) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int Engine::searchRoot(const Position& position, int depth, int previous) {
+    if (!m_options.aspiration || depth < ASPIRATION_DEPTH || std::abs(previous) > WIN - MAX_PLY) {
+        return negamax(position, depth, -WIN, WIN, 0);
+    }
+    int delta = ASPIRATION_WINDOW;
+    int alpha = std::max(previous - delta, -WIN);
+    int beta = std::min(previous + delta, WIN);
+    while (true) {
+        int score = negamax(position, depth, alpha, beta, 0);
+        if (m_stopped || (score > alpha && score < beta)) {
+            return score;
+        }
+        // Only the side that failed is widened
+        delta *= 2;
+        if (score <= alpha) {
+            alpha = delta > WIN / 4 ? -WIN : std::max(score - delta, -WIN);
+        } else {
+            beta = delta > WIN / 4 ? WIN : std::min(score + delta, WIN);
+        }
+    }
+}
+
+int Engine::quiesce(const Position& position, int alpha, int beta, int ply) {
+    // Captures are forced, so the side to move cannot stand pat while one is on: the
+    // position is only evaluated once nobody has to capture
+    if (ply >= MAX_PLY - 1 ||
+        (position.chainSquare < 0 && !EngineRules::hasCapture(position, position.getSideToMove()))) {
+        return evaluate(position, ply);
+    }
+
+    // Flying kings reach the same position along many paths, so the table pays off here
+    std::uint64_t key = hashKey(position);
+    const TranspositionTable::Entry* entry = m_table.probe(key);
+    int hashFrom = -1;
+    int hashTo = -1;
+    if (entry) {
+        hashFrom = entry->from;
+        hashTo = entry->to;
+        int score = fromTable(entry->score, ply);
+        if (entry->bound == TranspositionTable::Exact ||
+            (entry->bound == TranspositionTable::Lower && score >= beta) ||
+            (entry->bound == TranspositionTable::Upper && score <= alpha)) {
+            return score;
+        }
+    }
+
+    std::vector<Hop>& hops = m_hops[ply];
+    EngineRules::generateHops(position, position.getSideToMove(), hops);
+    scoreHops(position, ply, hashFrom, hashTo);
+
+    int originalAlpha = alpha;
+    int best = -WIN;
+    Hop bestHop = hops[0];
+    for (std::size_t i = 0; i < hops.size(); i++) {
+        const Hop hop = pickHop(ply, i);
+        Position child = position;
+        bool sameSide = EngineRules::applyHop(child, hop);
+        playHop(position, hop, child, ply);
+        m_pvLength[ply + 1] = ply + 1;
+        m_nodes++;
+        if (shouldStop()) {
+            return 0;
+        }
+        int score = sameSide ? quiesce(child, alpha, beta, ply + 1) : -quiesce(child, -beta, -alpha, ply + 1);
+        if (m_stopped) {
+            return 0;
+        }
+        if (score > best) {
+            best = score;
+            bestHop = hop;
+            if (score > alpha) {
+                alpha = score;
+                m_pv[ply][ply] = hop;
+                for (int next = ply + 1; next < m_pvLength[ply + 1]; next++) {
+                    m_pv[ply][next] = m_pv[ply + 1][next];
+                }
+                m_pvLength[ply] = std::max(m_pvLength[ply + 1], ply + 1);
+            }
+        }
+        if (alpha >= beta) {
+            break;
+        }
+    }
+
+    TranspositionTable::Bound bound = best >= beta ? TranspositionTable::Lower
+                                    : best > originalAlpha ? TranspositionTable::Exact
+                                                           : TranspositionTable::Upper;
+    m_table.store(key, toTable(best, ply), 0, bound, &bestHop);
+    return best;
+}
+
+int Engine::negamax(const Position& position, int depth, int alpha, int beta, int ply) {
+    m_pvLength[ply] = ply;
+    m_nodes++;
+    if (shouldStop()) {
+        return 0;
+    }
+    if (depth <= 0) {
+        if (m_options.quiescence) {
+            return quiesce(position, alpha, beta, ply);
+        }
+        // Without it, only a capture in progress is played out
+        if (position.chainSquare < 0) {
+            return evaluate(position, ply);
+        }
+    }
+    if (ply >= MAX_PLY - 1) {
+        return evaluate(position, ply);
+    }
+
+    // With moves left out of the first turn, its scores only hold for this search, and
+    // its variation has to reach the end of the turn
+    bool rootTurn = m_rootTurn[ply];
+    bool excluding = m_multiLine && rootTurn;
+
+    std::uint64_t key = hashKey(position);
+    const TranspositionTable::Entry* entry = m_table.probe(key);
+    int hashFrom = -1;
+    int hashTo = -1;
+    if (entry) {
+        hashFrom = entry->from;
+        hashTo = entry->to;
+        int score = fromTable(entry->score, ply);
+        if (ply > 0 && !excluding && entry->depth >= depth &&
+            (entry->bound == TranspositionTable::Exact ||
+             (entry->bound == TranspositionTable::Lower && score >= beta) ||
+             (entry->bound == TranspositionTable::Upper && score <= alpha))) {
+            return score;
+        }
+    }
+
+    std::vector<Hop>& hops = m_hops[ply];
+    EngineRules::generateHops(position, position.getSideToMove(), hops);
+    if (hops.empty()) {
+        // No move loses
+        return -WIN + ply;
+    }
+    scoreHops(position, ply, hashFrom, hashTo);
+
+    // Quiet hops near the leaves that cannot bring the score up to alpha are skipped
+    bool quiet = hops[0].captured < 0;
+    bool futile = false;
+    int futilityScore = 0;
+    if (m_options.pruning && quiet && !excluding && depth <= FUTILITY_DEPTH && std::abs(alpha) < WIN - MAX_PLY) {
+        futilityScore = evaluate(position, ply) + FUTILITY_MARGIN * depth;
+        futile = futilityScore <= alpha;
+    }
+
+    int originalAlpha = alpha;
+    int best = -WIN;
+    Hop bestHop = hops[0];
+    for (std::size_t i = 0; i < hops.size(); i++) {
+        const Hop hop = pickHop(ply, i);
+        // Killers and crownings are searched in full
+        bool late = quiet && m_scores[ply][i] < KILLER_SCORE;
+        if (i > 0 && late && futile) {
+            best = std::max(best, futilityScore);
+            continue;
+        }
+
+        Position child = position;
+        bool sameSide = EngineRules::applyHop(child, hop);
+        m_rootTurn[ply + 1] = rootTurn && sameSide;
+        if (excluding) {
+            if (!sameSide && isExcluded(hop, ply)) {
+                continue;
+            }
+            m_path[ply] = hop;
+        }
+        playHop(position, hop, child, ply);
+        // The rest of a capture is searched with the same window from the same side
+        auto search = [&](int childDepth, int low, int high) {
+            return sameSide ? negamax(child, childDepth, low, high, ply + 1)
+                            : -negamax(child, childDepth, -high, -low, ply + 1);
+        };
+        int childDepth = sameSide ? depth : depth - 1;
+        int score;
+        if (best == -WIN) {    // nothing searched yet
+            score = search(childDepth, alpha, beta);
+        } else {
+            // Late quiet hops go shallower, unless they start an exchange
+            int reduction = 0;
+            if (m_options.reductions && late && !sameSide && i >= REDUCTION_HOPS && depth >= REDUCTION_DEPTH &&
+                !EngineRules::hasCapture(child, child.getSideToMove())) {
+                reduction = (i >= 2 * REDUCTION_HOPS && depth >= 2 * REDUCTION_DEPTH) ? 2 : 1;
+            }
+            // Later hops are expected to fail low, which a null window shows more cheaply
+            int high = m_options.nullWindows ? alpha + 1 : beta;
+            score = search(childDepth - reduction, alpha, high);
+            if (reduction > 0 && score > alpha && !m_stopped) {
+                score = search(childDepth, alpha, high);
+            }
+            if (high < beta && score > alpha && score < beta && !m_stopped) {
+                score = search(childDepth, alpha, beta);
+            }
+        }
+        if (m_stopped) {
+            return 0;
+        }
+        if (score > best) {
+            best = score;
+            bestHop = hop;
+            if (score > alpha) {
+                alpha = score;
+                m_pv[ply][ply] = hop;
+                for (int next = ply + 1; next < m_pvLength[ply + 1]; next++) {
+                    m_pv[ply][next] = m_pv[ply + 1][next];
+                }
+                m_pvLength[ply] = std::max(m_pvLength[ply + 1], ply + 1);
+            }
+        }
+        if (alpha >= beta) {
+            recordCutoff(position, hop, depth, ply);
+            break;
+        }
+    }
+
+    TranspositionTable::Bound bound = best >= beta ? TranspositionTable::Lower
+                                    : best > originalAlpha ? TranspositionTable::Exact
+                                                           : TranspositionTable::Upper;
+    if (!excluding) {
+        m_table.store(key, toTable(best, ply), depth, bound, &bestHop);
+    }
+    return best;
+}
@@ -0,0 +1,408 @@
+#include "../include/EngineProtocol.hpp"
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::size_t MAX_HASH_MEGABYTES = 4096;
+constexpr int MAX_LINES = 32;
+// A clock is shared out as if this many moves were left
+constexpr double MOVES_TO_GO = 30;
+
+// Splits a line into its command and key=value arguments; a word without '=' is an
+// argument with an empty value. Returns false on an unclosed quote.
+bool parseLine(const std::string& line, std::string& command, std::map<std::string, std::string>& arguments) {
+    std::size_t i = 0;
+    auto skipSpace = [&]() {
+        while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) {
+            i++;
+        }
+    };
+    auto readWord = [&]() {
+        std::size_t start = i;
+        while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i])) && line[i] != '=') {
+            i++;
+        }
+        return line.substr(start, i - start);
+    };
+
+    skipSpace();
+    command = readWord();
+    while (true) {
+        skipSpace();
+        if (i >= line.size()) {
+            return true;
+        }
+        std::string key = readWord();
+        std::string value;
+        if (i < line.size() && line[i] == '=') {
+            i++;
+            if (i < line.size() && line[i] == '"') {
+                std::size_t end = line.find('"', i + 1);
+                if (end == std::string::npos) {
+                    return false;
+                }
+                value = line.substr(i + 1, end - i - 1);
+                i = end + 1;
+            } else {
+                std::size_t start = i;
+                while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i]))) {
+                    i++;
+                }
+                value = line.substr(start, i - start);
+            }
+        }
+        if (key.empty()) {
+            i++;
+            continue;
+        }
+        arguments[key] = value;
+    }
+}
+
+bool parseBool(const std::string& value) {
+    if (value == "true" || value == "1") {
+        return true;
+    }
+    if (value == "false" || value == "0") {
+        return false;
+    }
+    throw std::invalid_argument(value);
+}
+
+std::string turnText(const std::vector<Hop>& turn) {
+    std::string text;
+    for (const Hop& hop : turn) {
+        text += (text.empty() ? squareName(hop.from) : "") + (hop.captured >= 0 ? "x" : "-") + squareName(hop.to);
+    }
+    return text;
+}
+
+// Every complete move from the position, hop by hop
+void addTurns(const Position& position, std::vector<Hop>& turn, std::vector<std::vector<Hop>>& turns) {
+    std::vector<Hop> hops;
+    EngineRules::generateHops(position, position.getSideToMove(), hops);
+    for (const Hop& hop : hops) {
+        Position next = position;
+        turn.push_back(hop);
+        if (EngineRules::applyHop(next, hop)) {
+            addTurns(next, turn, turns);
+        } else {
+            turns.push_back(turn);
+        }
+        turn.pop_back();
+    }
+}
+
+// Reads "c3-d4", "c3xe5xc7" or the shorthand "c3xc7", squares by name or number, and
+// finds the legal move it means
+bool parseMove(const Position& position, const std::string& text, std::vector<Hop>& move) {
+    std::vector<int> squares;
+    std::size_t start = 0;
+    while (start <= text.size()) {
+        std::size_t end = std::min(text.find_first_of("-x", start), text.size());
+        int square = parseSquare(text.c_str() + start, end - start);
+        if (square < 0) {
+            return false;
+        }
+        squares.push_back(square);
+        start = end + 1;
+    }
+    if (squares.size() < 2) {
+        return false;
+    }
+
+    std::vector<Hop> turn;
+    std::vector<std::vector<Hop>> turns;
+    addTurns(position, turn, turns);
+    int matches = 0;
+    for (const std::vector<Hop>& candidate : turns) {
+        bool full = candidate.size() + 1 == squares.size() && candidate.front().from == squares.front();
+        for (std::size_t i = 0; i < candidate.size() && full; i++) {
+            full = candidate[i].to == squares[i + 1];
+        }
+        if (full) {
+            move = candidate;
+            return true;
+        }
+        if (squares.size() == 2 && candidate.front().from == squares.front() && candidate.back().to == squares.back()) {
+            move = candidate;
+            matches++;
+        }
+    }
+    return matches == 1;
+}
+
+} // namespace
+
+EngineProtocol::EngineProtocol(std::istream& input, std::ostream& output)
+    : m_input(input), m_output(output), m_engine(std::make_unique<Engine>(m_hashMegabytes)),
+      m_position(Position::initial()) {
+}
+
+EngineProtocol::~EngineProtocol() {
+    m_engine->stop();
+    join();
+}
+
+void EngineProtocol::run() {
+    std::string line;
+    while (std::getline(m_input, line)) {
+        if (!handle(line)) {
+            break;
+        }
+    }
+    m_engine->stop();
+    join();
+}
+
+bool EngineProtocol::handle(const std::string& line) {
+    std::string command;
+    Arguments arguments;
+    if (!parseLine(line, command, arguments)) {
+        error("unclosed quote");
+        return true;
+    }
+    bool busy = m_searching;
+    try {
+        if (command.empty()) {
+            return true;
+        } else if (command == "hub") {
+            send("id name=checkers-engine version=1.0");
+            sendParams();
+            send("wait");
+        } else if (command == "init") {
+            send("ready");
+        } else if (command == "ping") {
+            send("pong");
+        } else if (command == "quit") {
+            return false;
+        } else if (command == "stop") {
+            // Waits for done, so the next command always finds the engine idle
+            m_engine->stop();
+            join();
+        } else if (command == "pos") {
+            // The running search has its own copy of the position
+            if (!setPosition(arguments)) {
+                error("illegal position or move");
+            }
+        } else if (command == "level") {
+            SearchLimits limits;
+            if (toLimits(arguments, limits)) {
+                m_level = arguments;
+            } else {
+                error("unknown level");
+            }
+        } else if (busy && (command == "go" || command == "new-game" || command == "set-param")) {
+            error("still searching");
+        } else if (command == "new-game") {
+            join();
+            m_engine->clear();
+            m_position = Position::initial();
+        } else if (command == "set-param") {
+            join();
+            if (!setParam(arguments["name"], arguments["value"])) {
+                error("unknown parameter " + arguments["name"]);
+            }
+        } else if (command == "go") {
+            // Analysis runs until stopped unless this go sets limits; the level is for play
+            bool analyze = arguments.erase("analyze") > 0;
+            arguments.erase("think");
+            Arguments level = analyze ? Arguments() : m_level;
+            for (const auto& argument : arguments) {
+                level[argument.first] = argument.second;
+            }
+            SearchLimits limits;
+            if (!toLimits(level, limits)) {
+                error("unknown level");
+                return true;
+            }
+            join();
+            startSearch(limits);
+        } else {
+            error("unknown command " + command);
+        }
+    } catch (const std::exception&) {
+        error("bad value for " + command);
+    }
+    return true;
+}
+
+void EngineProtocol::send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(m_outputMutex);
+    m_output << line << '\n' << std::flush;
+}
+
+void EngineProtocol::error(const std::string& message) {
+    send("error message=\"" + message + "\"");
+}
+
+void EngineProtocol::sendParams() {
+    auto boolText = [](bool value) { return value ? "true" : "false"; };
+    send("param name=hash value=" + std::to_string(m_hashMegabytes) + " type=int min=1 max=" +
+         std::to_string(MAX_HASH_MEGABYTES));
+    send("param name=lines value=" + std::to_string(m_lines) + " type=int min=1 max=" + std::to_string(MAX_LINES));
+    send(std::string("param name=pvs value=") + boolText(m_options.nullWindows) + " type=bool");
+    send(std::string("param name=aspiration value=") + boolText(m_options.aspiration) + " type=bool");
+    send(std::string("param name=reductions value=") + boolText(m_options.reductions) + " type=bool");
+    send(std::string("param name=pruning value=") + boolText(m_options.pruning) + " type=bool");
+    send(std::string("param name=quiescence value=") + boolText(m_options.quiescence) + " type=bool");
+    send(std::string("param name=ordering value=") + boolText(m_options.ordering) + " type=bool");
+}
+
+bool EngineProtocol::setParam(const std::string& name, const std::string& value) {
+    if (name == "hash") {
+        std::size_t megabytes = static_cast<std::size_t>(std::stoul(value));
+        m_hashMegabytes = std::max<std::size_t>(1, std::min(megabytes, MAX_HASH_MEGABYTES));
+        m_engine = std::make_unique<Engine>(m_hashMegabytes);
+        m_engine->setOptions(m_options);
+        return true;
+    }
+    if (name == "lines") {
+        m_lines = std::max(1, std::min(std::stoi(value), MAX_LINES));
+        return true;
+    }
+    if (name == "pvs") {
+        m_options.nullWindows = parseBool(value);
+    } else if (name == "aspiration") {
+        m_options.aspiration = parseBool(value);
+    } else if (name == "reductions") {
+        m_options.reductions = parseBool(value);
+    } else if (name == "pruning") {
+        m_options.pruning = parseBool(value);
+    } else if (name == "quiescence") {
+        m_options.quiescence = parseBool(value);
+    } else if (name == "ordering") {
+        m_options.ordering = parseBool(value);
+    } else {
+        return false;
+    }
+    m_engine->setOptions(m_options);
+    return true;
+}
+
+bool EngineProtocol::setPosition(const Arguments& arguments) {
+    Position position = Position::initial();
+    auto fen = arguments.find("fen");
+    if (fen != arguments.end() && !Position::fromFen(fen->second, position)) {
+        return false;
+    }
+    auto moves = arguments.find("moves");
+    if (moves != arguments.end()) {
+        std::istringstream words(moves->second);
+        std::string word;
+        while (words >> word) {
+            std::vector<Hop> move;
+            if (!parseMove(position, word, move)) {
+                return false;
+            }
+            for (const Hop& hop : move) {
+                EngineRules::applyHop(position, hop);
+            }
+        }
+    }
+    m_position = position;
+    return true;
+}
+
+bool EngineProtocol::toLimits(const Arguments& level, SearchLimits& limits) {
+    limits = SearchLimits();
+    limits.lines = m_lines;
+    double time = 0;
+    double increment = 0;
+    for (const auto& argument : level) {
+        const std::string& key = argument.first;
+        if (key == "depth") {
+            limits.depth = std::stoi(argument.second);
+        } else if (key == "nodes") {
+            limits.nodes = std::stoull(argument.second);
+        } else if (key == "move-time") {
+            limits.milliseconds = std::max(1, static_cast<int>(std::stod(argument.second) * 1000));
+        } else if (key == "time") {
+            time = std::stod(argument.second);
+        } else if (key == "inc") {
+            increment = std::stod(argument.second);
+        } else {
+            return false;
+        }
+    }
+    // A fixed time per move wins over a clock
+    if (time > 0 && limits.milliseconds == 0) {
+        double seconds = std::min(time / MOVES_TO_GO + increment * 0.75, time / 2);
+        limits.milliseconds = std::max(1, static_cast<int>(seconds * 1000));
+    }
+    return true;
+}
+
+void EngineProtocol::startSearch(const SearchLimits& limits) {
+    Position position = m_position;
+    std::vector<Hop> turn;
+    std::vector<std::vector<Hop>> turns;
+    addTurns(position, turn, turns);
+    std::size_t lines = std::max<std::size_t>(1, std::min<std::size_t>(limits.lines, turns.size()));
+    int reported = 0;
+    m_engine->setProgress([this, position, lines, reported](const SearchResult& result) mutable {
+        // Several lines are reported together once a depth has all of them
+        const SearchLine& last = result.lines.back();
+        if (last.depth <= reported || result.lines.size() < lines || result.lines.front().depth != last.depth) {
+            return;
+        }
+        reported = last.depth;
+        double seconds = result.milliseconds / 1000;
+        for (std::size_t i = 0; i < result.lines.size(); i++) {
+            const SearchLine& line = result.lines[i];
+            std::ostringstream info;
+            info << "info";
+            if (result.lines.size() > 1) {
+                info << " line=" << i + 1;
+            }
+            info << " depth=" << line.depth << " score=" << line.score << " nodes=" << result.nodes << " time="
+                 << std::fixed << std::setprecision(3) << seconds << " nps=" << std::setprecision(0)
+                 << (seconds > 0 ? result.nodes / seconds : 0) << " pv=\"" << pvText(position, line.pv) << "\"";
+            send(info.str());
+        }
+    });
+
+    // Before the thread starts, so a stop sent right after go is not undone
+    m_engine->resume();
+    m_searching = true;
+    m_search = std::thread([this, position, limits]() {
+        SearchResult result = m_engine->search(position, limits);
+        std::string done = "done";
+        if (!result.turn.empty()) {
+            done += " move=" + turnText(result.turn);
+        }
+        if (!result.reply.empty()) {
+            done += " ponder=" + turnText(result.reply);
+        }
+        // Cleared first: a GUI may send its next go as soon as it reads done
+        m_searching = false;
+        send(done);
+    });
+}
+
+void EngineProtocol::join() {
+    if (m_search.joinable()) {
+        m_search.join();
+    }
+}
+
+std::string EngineProtocol::pvText(Position position, const std::vector<Hop>& pv) {
+    std::string text;
+    std::vector<Hop> turn;
+    for (const Hop& hop : pv) {
+        turn.push_back(hop);
+        if (!EngineRules::applyHop(position, hop)) {
+            text += (text.empty() ? "" : " ") + turnText(turn);
+            turn.clear();
+        }
+    }
+    // A variation cut short in the middle of a capture
+    if (!turn.empty()) {
+        text += (text.empty() ? "" : " ") + turnText(turn);
+    }
+    return text;
+}
@@ -0,0 +1,126 @@
+#include "../include/EngineService.hpp"
+#include <algorithm>
+
+namespace {
+
+// Enough for a few seconds of per-depth updates even if the caller stalls
+constexpr std::size_t UPDATE_CAPACITY = 1024;
+
+} // namespace
+
+EngineService::EngineService(unsigned int workers, std::size_t hashMegabytes)
+    : m_updates(UPDATE_CAPACITY) {
+    for (unsigned int i = 0; i < std::max(1u, workers); i++) {
+        m_workers.push_back(std::make_unique<Worker>(hashMegabytes));
+    }
+    for (auto& worker : m_workers) {
+        worker->thread = std::thread(&EngineService::work, this, std::ref(*worker));
+    }
+}
+
+EngineService::~EngineService() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_requests.clear();
+        for (auto& worker : m_workers) {
+            worker->engine.stop();
+        }
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker->thread.join();
+    }
+}
+
+std::uint64_t EngineService::submit(const Position& position, const SearchLimits& limits) {
+    std::uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = m_nextId++;
+        m_requests.push_back({id, position, limits});
+    }
+    m_wake.notify_one();
+    return id;
+}
+
+void EngineService::cancel(std::uint64_t request) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto queued = std::find_if(m_requests.begin(), m_requests.end(),
+                               [request](const Request& r) { return r.id == request; });
+    if (queued != m_requests.end()) {
+        m_requests.erase(queued);
+        return;
+    }
+    for (auto& worker : m_workers) {
+        if (worker->request == request) {
+            worker->cancelled = true;
+            worker->engine.stop();
+        }
+    }
+}
+
+void EngineService::cancelAll() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requests.clear();
+    for (auto& worker : m_workers) {
+        if (worker->request != 0) {
+            worker->cancelled = true;
+            worker->engine.stop();
+        }
+    }
+}
+
+bool EngineService::poll(EngineUpdate& update) {
+    return m_updates.tryPop(update);
+}
+
+void EngineService::publish(EngineUpdate& update) {
+    if (m_updates.tryPush(update)) {
+        return;
+    }
+    if (!update.final) {
+        m_dropped++;
+        return;
+    }
+    // The caller waits for final updates, so wait for room unless nobody will ever poll
+    while (!m_stopping && !m_updates.tryPush(update)) {
+        std::this_thread::yield();
+    }
+}
+
+void EngineService::work(Worker& worker) {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stopping || !m_requests.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            request = m_requests.front();
+            m_requests.pop_front();
+            worker.request = request.id;
+            worker.cancelled = false;
+            // Under the lock, so a cancel that comes right after is not undone
+            worker.engine.resume();
+        }
+
+        worker.engine.setProgress([this, &request](const SearchResult& result) {
+            EngineUpdate update;
+            update.request = request.id;
+            update.result = result;
+            publish(update);
+        });
+        EngineUpdate update;
+        update.request = request.id;
+        update.final = true;
+        update.result = worker.engine.search(request.position, request.limits);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            update.cancelled = worker.cancelled;
+            worker.request = 0;
+        }
+        publish(update);
+    }
+}
@@ -0,0 +1,221 @@
+#include "../include/Evaluator.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+using Geometry = tables::Geometry8;
+using Bits = Geometry::Bits;
+
+bool isCenter(int square) {
+    int row = Geometry::row(square);
+    int col = Geometry::col(square);
+    return row >= 2 && row <= 5 && col >= 2 && col <= 5;
+}
+
+// Squares a man could be stopped from: every square ahead of it that lies within as
+// many columns as rows, up to its crowning row. A man with none of them occupied has
+// a free run.
+struct RunawayCones {
+    Bits white[Geometry::SQUARES] = {};
+    Bits black[Geometry::SQUARES] = {};
+
+    constexpr RunawayCones() {
+        for (int square = 0; square < Geometry::SQUARES; square++) {
+            int row = Geometry::row(square);
+            int col = Geometry::col(square);
+            for (int target = 0; target < Geometry::SQUARES; target++) {
+                int rows = Geometry::row(target) - row;
+                int cols = Geometry::col(target) - col;
+                bool reachable = (cols < 0 ? -cols : cols) <= (rows < 0 ? -rows : rows);
+                if (rows < 0 && reachable) {
+                    white[square] |= Geometry::bit(target);
+                }
+                if (rows > 0 && reachable) {
+                    black[square] |= Geometry::bit(target);
+                }
+            }
+        }
+    }
+};
+
+constexpr RunawayCones CONES;
+
+// Only men in the opponent's half are checked: further back the cone covers too much
+// of the board to be empty while the game is still undecided
+constexpr Bits WHITE_RUNAWAY_ROWS = Geometry::rowMask(1) | Geometry::rowMask(2) | Geometry::rowMask(3);
+constexpr Bits BLACK_RUNAWAY_ROWS = Geometry::rowMask(4) | Geometry::rowMask(5) | Geometry::rowMask(6);
+
+// Positions of the weights in EvalWeights::toArray
+enum Term { MAN, KING, BACK_RANK, CENTER, KING_CENTER, TEMPO, RUNAWAY };
+
+// The terms a single piece adds on a square: piece types are white man, white king,
+// black man and black king, and Black's terms count negative
+EvalTerms squareTerms(int type, int square) {
+    EvalTerms terms{};
+    int row = Geometry::row(square);
+    bool white = type < 2;
+    bool king = type % 2 == 1;
+    if (king) {
+        terms[KING] = 1;
+        terms[KING_CENTER] = isCenter(square) ? 1 : 0;
+    } else {
+        terms[MAN] = 1;
+        terms[BACK_RANK] = row == (white ? Geometry::SIZE - 1 : 0) ? 1 : 0;
+        terms[CENTER] = isCenter(square) ? 1 : 0;
+        terms[TEMPO] = white ? Geometry::SIZE - 1 - row : row;
+    }
+    if (!white) {
+        for (int& term : terms) {
+            term = -term;
+        }
+    }
+    return terms;
+}
+
+} // namespace
+
+const char* const EvalWeights::NAMES[EvalWeights::TERMS] = {"man", "king", "backRank", "center", "kingCenter",
+                                                            "tempo", "runaway"};
+
+std::array<int, EvalWeights::TERMS> EvalWeights::toArray() const {
+    return {man, king, backRank, center, kingCenter, tempo, runaway};
+}
+
+EvalWeights EvalWeights::fromArray(const std::array<int, TERMS>& values) {
+    EvalWeights weights;
+    weights.man = values[MAN];
+    weights.king = values[KING];
+    weights.backRank = values[BACK_RANK];
+    weights.center = values[CENTER];
+    weights.kingCenter = values[KING_CENTER];
+    weights.tempo = values[TEMPO];
+    weights.runaway = values[RUNAWAY];
+    return weights;
+}
+
+bool EvalWeights::load(const std::string& path) {
+    std::ifstream input(path);
+    if (!input) {
+        std::cerr << "Cannot open weights " << path << std::endl;
+        return false;
+    }
+    std::array<int, TERMS> values = toArray();
+    std::string name;
+    int value;
+    while (input >> name >> value) {
+        const char* const* found = std::find(NAMES, NAMES + TERMS, name);
+        if (found == NAMES + TERMS) {
+            std::cerr << "Unknown weight " << name << " in " << path << std::endl;
+            return false;
+        }
+        values[found - NAMES] = value;
+    }
+    if (!input.eof()) {
+        std::cerr << "Malformed weights file " << path << std::endl;
+        return false;
+    }
+    *this = fromArray(values);
+    return true;
+}
+
+bool EvalWeights::save(const std::string& path) const {
+    std::ofstream output(path);
+    std::array<int, TERMS> values = toArray();
+    for (int term = 0; term < TERMS; term++) {
+        output << NAMES[term] << ' ' << values[term] << '\n';
+    }
+    if (!output.flush()) {
+        std::cerr << "Cannot write weights " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+Evaluator::Evaluator(const EvalWeights& weights)
+    : m_weights(weights) {
+    std::array<int, EvalWeights::TERMS> values = weights.toArray();
+    for (int type = 0; type < PIECE_TYPES; type++) {
+        for (int square = 0; square < Geometry::SQUARES; square++) {
+            EvalTerms terms = squareTerms(type, square);
+            int score = 0;
+            for (int term = 0; term < EvalWeights::TERMS; term++) {
+                score += terms[term] * values[term];
+            }
+            m_pieceSquare[type][square] = score;
+        }
+    }
+}
+
+int Evaluator::pieceType(const Position& position, int square) {
+    Bits bit = Geometry::bit(square);
+    return ((position.white & bit) ? 0 : 2) + ((position.kings & bit) ? 1 : 0);
+}
+
+EvalState Evaluator::computeState(const Position& position) const {
+    const Bits byType[PIECE_TYPES] = {position.white & ~position.kings, position.white & position.kings,
+                                      position.black & ~position.kings, position.black & position.kings};
+    EvalState state;
+    for (int type = 0; type < PIECE_TYPES; type++) {
+        for (Bits pieces = byType[type]; pieces; pieces &= pieces - 1) {
+            state.score += m_pieceSquare[type][lowestSquare(pieces)];
+        }
+    }
+    return state;
+}
+
+void Evaluator::update(EvalState& state, const Position& before, const Hop& hop, const Position& after) const {
+    // The piece leaves its square and arrives, possibly crowned, on the next one
+    state.score -= m_pieceSquare[pieceType(before, hop.from)][hop.from];
+    state.score += m_pieceSquare[pieceType(after, hop.to)][hop.to];
+    if (hop.captured >= 0) {
+        state.score -= m_pieceSquare[pieceType(before, hop.captured)][hop.captured];
+    }
+}
+
+int Evaluator::runawayScore(const Position& position) const {
+    Bits occupied = position.getOccupied();
+    int score = 0;
+    for (Bits men = position.white & ~position.kings & WHITE_RUNAWAY_ROWS; men; men &= men - 1) {
+        if (!(CONES.white[lowestSquare(men)] & occupied)) {
+            score += m_weights.runaway;
+        }
+    }
+    for (Bits men = position.black & ~position.kings & BLACK_RUNAWAY_ROWS; men; men &= men - 1) {
+        if (!(CONES.black[lowestSquare(men)] & occupied)) {
+            score -= m_weights.runaway;
+        }
+    }
+    return score;
+}
+
+int Evaluator::evaluate(const Position& position, const EvalState& state) const {
+    int score = state.score + runawayScore(position);
+    return position.blackToMove ? -score : score;
+}
+
+void Evaluator::evaluateBatch(const Position* positions, std::size_t count, int* scores) const {
+    for (std::size_t i = 0; i < count; i++) {
+        scores[i] = evaluate(positions[i]);
+    }
+}
+
+EvalTerms Evaluator::countTerms(const Position& position) {
+    EvalTerms terms{};
+    for (Bits pieces = position.getOccupied(); pieces; pieces &= pieces - 1) {
+        int square = lowestSquare(pieces);
+        EvalTerms piece = squareTerms(pieceType(position, square), square);
+        for (int term = 0; term < EvalWeights::TERMS; term++) {
+            terms[term] += piece[term];
+        }
+    }
+    Bits occupied = position.getOccupied();
+    for (Bits men = position.white & ~position.kings & WHITE_RUNAWAY_ROWS; men; men &= men - 1) {
+        terms[RUNAWAY] += (CONES.white[lowestSquare(men)] & occupied) ? 0 : 1;
+    }
+    for (Bits men = position.black & ~position.kings & BLACK_RUNAWAY_ROWS; men; men &= men - 1) {
+        terms[RUNAWAY] -= (CONES.black[lowestSquare(men)] & occupied) ? 0 : 1;
+    }
+    return terms;
+}
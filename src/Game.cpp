@@ -1,5 +1,7 @@
 #include "../include/Game.hpp"
+#include <chrono>
 #include <iostream>
+#include <thread>
 
 struct MoveResult {
     bool moved = false;
@@ -10,6 +12,7 @@ struct MoveResult {
 Game::Game(int windowWidth, int windowHeight)
     : m_window(sf::VideoMode({static_cast<unsigned int>(windowWidth), static_cast<unsigned int>(windowHeight)}), "Checkers Game"),
       m_board(nullptr),
+      m_boardSize(std::min(windowWidth, windowHeight) * 0.9f),
       m_currentPlayer(PieceColor::White),
       m_gameOver(false),
       m_state(GameState::MainMenu),
@@ -20,11 +23,8 @@ Game::Game(int windowWidth, int windowHeight)
     
     m_window.setFramerateLimit(60);
     
-    // Calculate board size to fit the window
-    float boardSize = std::min(windowWidth, windowHeight) * 0.9f;
-    
     // Create the game board
-    m_board = new Board(boardSize);
+    m_board = new Board(m_boardSize);
     
     // Load the font
     if (!m_font.openFromFile("fonts/arial.ttf")) {
@@ -44,11 +44,33 @@ Game::Game(int windowWidth, int windowHeight)
     m_ipInputText.setFillColor(sf::Color::White);
 }
 
+Game::Game(std::unique_ptr<PlayerController> controller)
+    : m_board(nullptr),
+      m_boardSize(720.f),
+      m_currentPlayer(PieceColor::White),
+      m_gameOver(false),
+      m_state(GameState::MainMenu),
+      m_gameMode(GameMode::LocalGame),
+      m_isMyTurn(true),
+      m_headless(true),
+      m_controller(std::move(controller)),
+      m_statusText(m_font),
+      m_ipInputText(m_font) {
+    
+    // The board still keeps its shapes, but nothing is ever drawn
+    m_board = new Board(m_boardSize);
+}
+
 Game::~Game() {
     delete m_board;
 }
 
 void Game::run() {
+    if (m_headless) {
+        runHeadless();
+        return;
+    }
+    
     while (m_window.isOpen()) {
         handleEvents();
         update();
@@ -84,12 +106,15 @@ void Game::handleMainMenuEvents(const sf::Event& event) {
             float w = m_window.getSize().x;
             float h = m_window.getSize().y;
             sf::FloatRect singlePlayerBtn(sf::Vector2f(w/2-150, h/2-100), sf::Vector2f(300, 50));
-            sf::FloatRect multiplayerBtn(sf::Vector2f(w/2-150, h/2-20), sf::Vector2f(300, 50));
-            sf::FloatRect exitBtn(sf::Vector2f(w/2-150, h/2+60), sf::Vector2f(300, 50));
+            sf::FloatRect computerBtn(sf::Vector2f(w/2-150, h/2-20), sf::Vector2f(300, 50));
+            sf::FloatRect multiplayerBtn(sf::Vector2f(w/2-150, h/2+60), sf::Vector2f(300, 50));
+            sf::FloatRect exitBtn(sf::Vector2f(w/2-150, h/2+140), sf::Vector2f(300, 50));
             sf::Vector2f mousePos(mousePressed->position.x, mousePressed->position.y);
             
             if (singlePlayerBtn.contains(mousePos)) {
                 startLocalGame();
+            } else if (computerBtn.contains(mousePos)) {
+                startEngineGame();
             } else if (multiplayerBtn.contains(mousePos)) {
                 m_state = GameState::MultiplayerMenu;
             } else if (exitBtn.contains(mousePos)) {
@@ -137,11 +162,6 @@ void Game::handleHostMenuEvents(const sf::Event& event) {
             }
         }
     }
-    
-    // Check if connection established
-    if (m_network.getStatus() == NetworkStatus::Connected) {
-        startNetworkGame(GameMode::NetworkHost);
-    }
 }
 
 void Game::handleJoinMenuEvents(const sf::Event& event) {
@@ -155,6 +175,7 @@ void Game::handleJoinMenuEvents(const sf::Event& event) {
             
             if (connectBtn.contains(mousePos)) {
                 if (!m_ipAddress.empty()) {
+                    m_spectating = false;
                     m_network.connectToGame(m_ipAddress);
                 }
             } else if (backBtn.contains(mousePos)) {
@@ -172,11 +193,6 @@ void Game::handleJoinMenuEvents(const sf::Event& event) {
         }
         m_ipInputText.setString(m_ipAddress);
     }
-    
-    // Check if connection established
-    if (m_network.getStatus() == NetworkStatus::Connected) {
-        startNetworkGame(GameMode::NetworkClient);
-    }
 }
 
 void Game::handleGamePlayEvents(const sf::Event& event) {
@@ -184,7 +200,11 @@ void Game::handleGamePlayEvents(const sf::Event& event) {
         if (const auto* keyPressed = event.getIf<sf::Event::KeyPressed>()) {
             if (keyPressed->code == sf::Keyboard::Key::R) {
                 if (m_gameMode == GameMode::LocalGame) {
-                    startLocalGame();
+                    if (m_versusEngine) {
+                        startEngineGame();
+                    } else {
+                        startLocalGame();
+                    }
                 } else {
                     // Return to main menu for network games
                     m_network.disconnect();
@@ -192,6 +212,7 @@ void Game::handleGamePlayEvents(const sf::Event& event) {
                 }
             } else if (keyPressed->code == sf::Keyboard::Key::Escape) {
                 m_network.disconnect();
+                cancelEngineSearch();
                 m_state = GameState::MainMenu;
             }
         }
@@ -202,68 +223,214 @@ void Game::handleGamePlayEvents(const sf::Event& event) {
     if (const auto* mousePressed = event.getIf<sf::Event::MouseButtonPressed>()) {
         if (mousePressed->button == sf::Mouse::Button::Left) {
             // In network games, only allow moves on your turn
-            if (m_gameMode != GameMode::LocalGame && !m_isMyTurn) {
+            if (m_gameMode != GameMode::LocalGame && !canMoveOnline()) {
+                return;
+            }
+            if (m_versusEngine && m_currentPlayer == PieceColor::Black) {
                 return;
             }
             
             Board::MoveResult moveResult = m_board->handleClick(mousePressed->position.x, mousePressed->position.y, m_currentPlayer);
             if (moveResult.moved) {
-                // In network game, send the move
-                if (m_gameMode != GameMode::LocalGame) {
-                    int fromRow = m_board->getLastMoveFromRow();
-                    int fromCol = m_board->getLastMoveFromCol();
-                    int toRow = m_board->getLastMoveToRow();
-                    int toCol = m_board->getLastMoveToCol();
-                    m_network.sendMove(fromRow, fromCol, toRow, toCol);
-                    m_isMyTurn = false;
-                }
-                
-                // If no chain capture is possible, switch player
-                if (!moveResult.canChain) {
-                    switchPlayer();
-                }
-                
-                // Check if game is over
-                if (isGameOver()) {
-                    m_gameOver = true;
-                    if (m_currentPlayer == PieceColor::White) {
-                        m_winnerText = "Black Wins!";
-                    } else {
-                        m_winnerText = "White Wins!";
-                    }
-                }
+                commitLocalMove(m_board->getLastMoveFromRow(), m_board->getLastMoveFromCol(),
+                                m_board->getLastMoveToRow(), m_board->getLastMoveToCol(), moveResult);
             }
         }
     } else if (const auto* keyPressed = event.getIf<sf::Event::KeyPressed>()) {
         if (keyPressed->code == sf::Keyboard::Key::Escape) {
             // Return to main menu
             m_network.disconnect();
+            cancelEngineSearch();
             m_state = GameState::MainMenu;
         }
     }
 }
 
 void Game::update() {
+    // Check if connection established
+    if (m_state == GameState::HostMenu && m_network.getStatus() == NetworkStatus::Connected) {
+        startNetworkGame(GameMode::NetworkHost);
+    } else if (m_state == GameState::JoinMenu && m_network.getStatus() == NetworkStatus::Connected) {
+        startNetworkGame(m_spectating ? GameMode::Spectator : GameMode::NetworkClient);
+    }
+    
+    if (m_state == GameState::Playing && m_versusEngine) {
+        updateEngine();
+    }
+    
+    if (m_state != GameState::Playing || m_gameMode == GameMode::LocalGame) {
+        return;
+    }
+    
+    // A game server tells us which side we play
+    GameStartMessage gameStart;
+    if (m_network.takeGameStart(gameStart)) {
+        m_isMyTurn = (gameStart.color == m_currentPlayer);
+        m_roomId = gameStart.roomId;
+    }
+    
+    // Spectators start, and catch up after falling behind, from a position
+    SpectateMessage spectate;
+    if (m_network.takeSpectate(spectate)) {
+        m_board->loadPosition(spectate.position);
+        m_currentPlayer = spectate.position.getSideToMove();
+        m_moveCount = spectate.moveCount;
+        m_roomId = spectate.roomId;
+    }
+    
+    // After a reconnect the server sends the position and the moves we missed
+    ResyncMessage resync;
+    if (m_network.takeResync(resync)) {
+        applyResync(resync);
+    }
+    
     // For network games, check for received moves
-    if (m_gameMode != GameMode::LocalGame && !m_isMyTurn && m_network.hasReceivedMove()) {
+    if (!m_isMyTurn && m_network.hasReceivedMove()) {
         NetworkMove move = m_network.getReceivedMove();
-        if (m_board->movePiece(move.fromRow, move.fromCol, move.toRow, move.toCol)) {
-            m_isMyTurn = true;
+        Board::MoveResult result = m_board->applyMove(move.fromRow, move.fromCol, move.toRow, move.toCol, m_currentPlayer);
+        // The opponent keeps the turn while a multi-capture continues
+        if (result.moved && !result.canChain) {
+            m_isMyTurn = (m_gameMode != GameMode::Spectator);
+            finishTurn();
+        }
+    }
+    
+    // The server ends games on time, disconnects and the move limit
+    GameOverMessage gameOver;
+    if (!m_network.hasReceivedMove() && m_network.takeGameOver(gameOver) && !m_gameOver) {
+        m_gameOver = true;
+        std::string winner = (gameOver.winner == PieceColor::White) ? "White" : "Black";
+        if (gameOver.draw) {
+            m_winnerText = "Draw!";
+        } else if (gameOver.reason == GameOverReason::Timeout) {
+            m_winnerText = winner + " Wins on Time!";
+        } else if (gameOver.reason == GameOverReason::Disconnect) {
+            m_winnerText = winner + " Wins, Opponent Left!";
+        } else if (gameOver.reason == GameOverReason::Abandoned) {
+            m_winnerText = m_spectating ? "No game to watch" : "Game could not be resumed";
+        } else {
+            m_winnerText = winner + " Wins!";
+        }
+    }
+}
+
+void Game::commitLocalMove(int fromRow, int fromCol, int toRow, int toCol, const Board::MoveResult& result) {
+    // In network game, send the move
+    if (m_gameMode != GameMode::LocalGame) {
+        m_network.sendMove(fromRow, fromCol, toRow, toCol);
+        if (!result.canChain) {
+            m_isMyTurn = false;
+        }
+    }
+    
+    // If no chain capture is possible, switch player
+    if (!result.canChain) {
+        finishTurn();
+    }
+}
+
+void Game::applyResync(const ResyncMessage& resync) {
+    m_board->loadPosition(resync.position);
+    m_currentPlayer = resync.position.getSideToMove();
+    m_moveCount = resync.moveCount;
+    
+    for (const Board::Move& move : resync.moves) {
+        Board::MoveResult result = m_board->applyMove(move.fromRow, move.fromCol, move.toRow, move.toCol, m_currentPlayer);
+        if (result.moved && !result.canChain) {
             switchPlayer();
-            
-            // Check if game is over
-            if (isGameOver()) {
+            m_moveCount++;
+        }
+    }
+    m_isMyTurn = (m_currentPlayer == resync.color);
+}
+
+bool Game::canMoveOnline() const {
+    // Moves made while reconnecting would be lost
+    return m_isMyTurn && m_network.getStatus() == NetworkStatus::Connected;
+}
+
+void Game::finishTurn() {
+    switchPlayer();
+    m_moveCount++;
+    
+    // Check if game is over
+    if (isGameOver()) {
+        m_gameOver = true;
+        if (m_currentPlayer == PieceColor::White) {
+            m_winnerText = "Black Wins!";
+        } else {
+            m_winnerText = "White Wins!";
+        }
+    }
+}
+
+void Game::runHeadless() {
+    while (true) {
+        update();
+        
+        if (m_state == GameState::Playing) {
+            if (m_gameOver) {
+                break;
+            }
+            if (m_gameMode != GameMode::LocalGame && m_network.getStatus() == NetworkStatus::Disconnected) {
+                m_winnerText = "Opponent disconnected";
+                break;
+            }
+            if (m_moveCount >= m_moveLimit) {
                 m_gameOver = true;
-                if (m_currentPlayer == PieceColor::White) {
-                    m_winnerText = "Black Wins!";
-                } else {
-                    m_winnerText = "White Wins!";
+                m_winnerText = "Draw (move limit)";
+                break;
+            }
+            if (m_gameMode == GameMode::LocalGame || canMoveOnline()) {
+                if (!playControllerMove()) {
+                    break;
                 }
+                continue;
             }
+        } else if (m_state == GameState::MainMenu) {
+            // No game was started
+            break;
+        } else if (m_network.getStatus() == NetworkStatus::Disconnected) {
+            // Hosting or joining failed
+            m_winnerText = m_network.getStatusText();
+            break;
         }
+        
+        // Wait for the opponent without spinning
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    
+    if (m_controller) {
+        m_controller->stopPondering();
     }
 }
 
+bool Game::playControllerMove() {
+    if (m_thinkTimeMs > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_thinkTimeMs));
+    }
+    
+    Board::Move move;
+    if (!m_controller || !m_controller->chooseMove(*m_board, m_currentPlayer, move)) {
+        m_winnerText = "Controller has no move";
+        return false;
+    }
+    
+    Board::MoveResult result = m_board->applyMove(move.fromRow, move.fromCol, move.toRow, move.toCol, m_currentPlayer);
+    if (!result.moved) {
+        m_winnerText = "Controller played an illegal move";
+        return false;
+    }
+    
+    commitLocalMove(move.fromRow, move.fromCol, move.toRow, move.toCol, result);
+    
+    // The controller may think about its next move while the opponent decides theirs
+    if (m_gameMode != GameMode::LocalGame && !m_isMyTurn && !m_gameOver) {
+        m_controller->startPondering(*m_board, m_currentPlayer);
+    }
+    return true;
+}
+
 void Game::render() {
     m_window.clear(sf::Color(50, 50, 50));
     
@@ -314,14 +481,60 @@ void Game::render() {
             playerText.setPosition({20, 20});
             m_window.draw(playerText);
             
+            // What the engine is thinking, updated as each depth completes
+            if (m_versusEngine && !m_engineInfo.empty()) {
+                sf::Text engineText(m_font);
+                engineText.setString(m_engineInfo);
+                engineText.setCharacterSize(18);
+                engineText.setFillColor(sf::Color(200, 200, 200));
+                engineText.setPosition({20, static_cast<float>(m_window.getSize().y - 40)});
+                m_window.draw(engineText);
+            }
+            
             // Draw network status if in network game
             if (m_gameMode != GameMode::LocalGame) {
+                std::string turnText = m_isMyTurn ? "Your Turn" : "Opponent's Turn";
+                sf::Color turnColor = m_isMyTurn ? sf::Color::Green : sf::Color::Red;
+                if (m_gameMode == GameMode::Spectator) {
+                    turnText = "Watching";
+                    turnColor = sf::Color::White;
+                }
+                if (m_roomId != 0) {
+                    turnText = "Room " + std::to_string(m_roomId) + "   " + turnText;
+                }
+                LatencyStats latency = m_network.getLatencyStats();
+                if (m_network.getStatus() == NetworkStatus::Reconnecting) {
+                    turnText = "Reconnecting...";
+                    turnColor = sf::Color::Yellow;
+                } else if (latency.pongsReceived > 0) {
+                    turnText += "   Ping: " + std::to_string(static_cast<int>(latency.smoothedRttMs + 0.5)) + " ms";
+                }
+                
                 sf::Text networkText(m_font);
-                networkText.setString(m_isMyTurn ? "Your Turn" : "Opponent's Turn");
+                networkText.setString(turnText);
                 networkText.setCharacterSize(20);
-                networkText.setFillColor(m_isMyTurn ? sf::Color::Green : sf::Color::Red);
+                networkText.setFillColor(turnColor);
                 networkText.setPosition({20, static_cast<float>(m_window.getSize().y - 40)});
                 m_window.draw(networkText);
+                
+                // Draw the clocks of a timed server game
+                ClockMessage clock;
+                std::int64_t receivedAt;
+                if (m_network.getClock(clock, receivedAt)) {
+                    std::int64_t elapsed = monotonicMicros() - receivedAt;
+                    std::int64_t white = clock.whiteMicros - (clock.sideToMove == PieceColor::White ? elapsed : 0);
+                    std::int64_t black = clock.blackMicros - (clock.sideToMove == PieceColor::Black ? elapsed : 0);
+                    
+                    sf::Text clockText(m_font);
+                    clockText.setString("White " + formatClock(white) + "   Black " + formatClock(black));
+                    clockText.setCharacterSize(20);
+                    clockText.setFillColor(sf::Color::White);
+                    clockText.setPosition({
+                        m_window.getSize().x - clockText.getLocalBounds().size.x - 20,
+                        static_cast<float>(m_window.getSize().y - 40)
+                    });
+                    m_window.draw(clockText);
+                }
             }
         }
     }
@@ -329,28 +542,29 @@ void Game::render() {
     m_window.display();
 }
 
+std::string Game::formatClock(std::int64_t micros) {
+    if (micros < 0) {
+        micros = 0;
+    }
+    std::int64_t tenths = micros / 100000;
+    std::int64_t minutes = tenths / 600;
+    std::int64_t seconds = (tenths / 10) % 60;
+    
+    std::string text = std::to_string(minutes) + ":" + (seconds < 10 ? "0" : "") + std::to_string(seconds);
+    // Show tenths when time is running low
+    if (minutes == 0 && seconds < 10) {
+        text += "." + std::to_string(tenths % 10);
+    }
+    return text;
+}
+
 void Game::switchPlayer() {
     m_currentPlayer = (m_currentPlayer == PieceColor::White) ? PieceColor::Black : PieceColor::White;
 }
 
 bool Game::isGameOver() {
-    // Check if the current player has any valid moves
-    for (int row = 0; row < 8; row++) {
-        for (int col = 0; col < 8; col++) {
-            Piece* piece = m_board->getPieceAt(row, col);
-            if (piece && piece->isAlive() && piece->getColor() == m_currentPlayer) {
-                // Check for any valid moves for this piece
-                for (int newRow = 0; newRow < 8; newRow++) {
-                    for (int newCol = 0; newCol < 8; newCol++) {
-                        if (m_board->isValidMove(row, col, newRow, newCol)) {
-                            return false;  // Found a valid move, game not over
-                        }
-                    }
-                }
-            }
-        }
-    }
-    return true;  // No valid moves, game over
+    // No legal move for the side to move ends the game
+    return !m_board->hasLegalMove(m_currentPlayer);
 }
 
 sf::RectangleShape Game::createButton(float x, float y, float width, float height, const sf::Color& color) {
@@ -390,18 +604,22 @@ void Game::renderMainMenu() {
     m_window.draw(title);
     
     auto singlePlayerBtn = createButton(w/2-150, h/2-100, 300, 50, sf::Color(100, 100, 200));
-    auto multiplayerBtn = createButton(w/2-150, h/2-20, 300, 50, sf::Color(100, 100, 200));
-    auto exitBtn = createButton(w/2-150, h/2+60, 300, 50, sf::Color(200, 100, 100));
+    auto computerBtn = createButton(w/2-150, h/2-20, 300, 50, sf::Color(100, 100, 200));
+    auto multiplayerBtn = createButton(w/2-150, h/2+60, 300, 50, sf::Color(100, 100, 200));
+    auto exitBtn = createButton(w/2-150, h/2+140, 300, 50, sf::Color(200, 100, 100));
     
     m_window.draw(singlePlayerBtn);
+    m_window.draw(computerBtn);
     m_window.draw(multiplayerBtn);
     m_window.draw(exitBtn);
     
     auto singlePlayerText = createButtonText("Single Player", w/2, h/2-75, 24);
-    auto multiplayerText = createButtonText("Multiplayer", w/2, h/2+5, 24);
-    auto exitText = createButtonText("Exit", w/2, h/2+85, 24);
+    auto computerText = createButtonText("Play Computer", w/2, h/2+5, 24);
+    auto multiplayerText = createButtonText("Multiplayer", w/2, h/2+85, 24);
+    auto exitText = createButtonText("Exit", w/2, h/2+165, 24);
     
     m_window.draw(singlePlayerText);
+    m_window.draw(computerText);
     m_window.draw(multiplayerText);
     m_window.draw(exitText);
 }
@@ -545,26 +763,100 @@ void Game::renderJoinMenu() {
 void Game::startLocalGame() {
     // Reset the board
     delete m_board;
-    float boardSize = std::min(m_window.getSize().x, m_window.getSize().y) * 0.9f;
-    m_board = new Board(boardSize);
+    m_board = new Board(m_boardSize);
     
     // Set up game state
     m_gameMode = GameMode::LocalGame;
     m_currentPlayer = PieceColor::White;
     m_gameOver = false;
+    m_moveCount = 0;
     m_state = GameState::Playing;
+    
+    cancelEngineSearch();
+    m_versusEngine = false;
+}
+
+void Game::startEngineGame() {
+    startLocalGame();
+    if (!m_engine) {
+        m_engine = std::make_unique<EngineService>();
+        m_engineLimits.depth = 64;
+        m_engineLimits.milliseconds = 1000;
+    }
+    m_versusEngine = true;
+}
+
+void Game::cancelEngineSearch() {
+    if (m_engine && m_engineRequest != 0) {
+        m_engine->cancel(m_engineRequest);
+    }
+    m_engineRequest = 0;
+    m_engineInfo.clear();
+}
+
+void Game::updateEngine() {
+    // Updates of cancelled searches may still be queued; only the current one counts
+    EngineUpdate update;
+    while (m_engine->poll(update)) {
+        if (update.request != m_engineRequest) {
+            continue;
+        }
+        const SearchResult& result = update.result;
+        m_engineInfo = "Depth " + std::to_string(result.depth) + "   Score " + std::to_string(result.score) + "  ";
+        for (std::size_t i = 0; i < result.pv.size() && i < 8; i++) {
+            const Hop& hop = result.pv[i];
+            m_engineInfo += " " + squareName(hop.from) + (hop.captured >= 0 ? "x" : "-") + squareName(hop.to);
+        }
+        if (!update.final) {
+            continue;
+        }
+        
+        m_engineRequest = 0;
+        for (const Hop& hop : result.turn) {
+            int fromRow = squareRow(hop.from);
+            int fromCol = squareCol(hop.from);
+            int toRow = squareRow(hop.to);
+            int toCol = squareCol(hop.to);
+            Board::MoveResult moveResult = m_board->applyMove(fromRow, fromCol, toRow, toCol, m_currentPlayer);
+            if (!moveResult.moved) {
+                break;
+            }
+            commitLocalMove(fromRow, fromCol, toRow, toCol, moveResult);
+        }
+    }
+    
+    if (!m_gameOver && m_currentPlayer == PieceColor::Black && m_engineRequest == 0) {
+        m_engineRequest = m_engine->submit(m_board->getPosition(m_currentPlayer), m_engineLimits);
+    }
+}
+
+bool Game::hostGame(unsigned short port) {
+    m_state = GameState::HostMenu;
+    return m_network.hostGame(port);
+}
+
+bool Game::joinGame(const std::string& ip, unsigned short port) {
+    m_state = GameState::JoinMenu;
+    m_spectating = false;
+    return m_network.connectToGame(ip, port);
+}
+
+bool Game::watchGame(const std::string& ip, unsigned short port, std::uint32_t roomId) {
+    m_state = GameState::JoinMenu;
+    m_spectating = true;
+    return m_network.watchGame(ip, port, roomId);
 }
 
 void Game::startNetworkGame(GameMode mode) {
     // Reset the board
     delete m_board;
-    float boardSize = std::min(m_window.getSize().x, m_window.getSize().y) * 0.9f;
-    m_board = new Board(boardSize);
+    m_board = new Board(m_boardSize);
     
     // Set up game state
     m_gameMode = mode;
     m_currentPlayer = PieceColor::White;
     m_gameOver = false;
+    m_moveCount = 0;
     
     // Set player turn based on role
     m_isMyTurn = (mode == GameMode::NetworkHost);
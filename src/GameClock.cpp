@@ -0,0 +1,59 @@
+#include "../include/GameClock.hpp"
+#include <algorithm>
+
+GameClock::GameClock(const TimeControl& timeControl)
+    : m_timeControl(timeControl) {
+    m_remaining[0] = timeControl.initialMicros;
+    m_remaining[1] = timeControl.initialMicros;
+}
+
+void GameClock::start(PieceColor side, std::int64_t now) {
+    m_running = side;
+    m_turnStart = now;
+}
+
+void GameClock::restore(std::int64_t whiteMicros, std::int64_t blackMicros, PieceColor side, std::int64_t now) {
+    m_remaining[0] = whiteMicros;
+    m_remaining[1] = blackMicros;
+    start(side, now);
+}
+
+bool GameClock::completeTurn(std::int64_t now, std::int64_t lagAllowance) {
+    std::int64_t& remaining = m_remaining[index(m_running)];
+    remaining -= charge(std::max<std::int64_t>(now - m_turnStart - lagAllowance, 0));
+    bool flagged = isTimed() && remaining < 0;
+    
+    if (!flagged && m_timeControl.type == TimeControlType::Fischer) {
+        remaining += m_timeControl.incrementMicros;
+    }
+    
+    m_running = (m_running == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+    m_turnStart = now;
+    return !flagged;
+}
+
+std::int64_t GameClock::getRemaining(PieceColor side, std::int64_t now) const {
+    std::int64_t remaining = m_remaining[index(side)];
+    if (side == m_running) {
+        remaining -= charge(std::max<std::int64_t>(now - m_turnStart, 0));
+    }
+    return remaining;
+}
+
+std::int64_t GameClock::getFlagTime() const {
+    std::int64_t flagTime = m_turnStart + m_remaining[index(m_running)];
+    if (m_timeControl.type == TimeControlType::Delay) {
+        flagTime += m_timeControl.incrementMicros;
+    }
+    return flagTime;
+}
+
+std::int64_t GameClock::charge(std::int64_t elapsed) const {
+    if (!isTimed()) {
+        return 0;
+    }
+    if (m_timeControl.type == TimeControlType::Delay) {
+        return std::max<std::int64_t>(elapsed - m_timeControl.incrementMicros, 0);
+    }
+    return elapsed;
+}
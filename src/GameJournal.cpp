@@ -0,0 +1,383 @@
+#include "../include/GameJournal.hpp"
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char JOURNAL_MAGIC[4] = {'C', 'K', 'J', '1'};
+
+enum class RecordType : std::uint8_t { RoomStart = 1, Move = 2, RoomEnd = 3 };
+
+// A running server compacts the journal once it is this large and more than twice
+// what the games in progress need
+constexpr std::uint64_t COMPACT_MIN_BYTES = 64 * 1024 * 1024;
+// A framed RoomStart, the largest record
+constexpr std::uint64_t MAX_RECORD_BYTES = 46;
+
+// CRC-32 (IEEE 802.3), table driven
+std::uint32_t crc32(const std::uint8_t* data, std::size_t size) {
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> entries{};
+        for (std::uint32_t i = 0; i < 256; i++) {
+            std::uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            entries[i] = crc;
+        }
+        return entries;
+    }();
+    
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Little-endian encoding into a fixed buffer; records are at most a few dozen bytes
+class RecordWriter {
+public:
+    void put(std::uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            m_data[m_size++] = static_cast<std::uint8_t>(value >> (8 * i));
+        }
+    }
+    void u8(std::uint8_t value) { put(value, 1); }
+    void u32(std::uint32_t value) { put(value, 4); }
+    void u64(std::uint64_t value) { put(value, 8); }
+    void i64(std::int64_t value) { put(static_cast<std::uint64_t>(value), 8); }
+    
+    const std::uint8_t* data() const { return m_data.data(); }
+    std::size_t size() const { return m_size; }
+    
+private:
+    std::array<std::uint8_t, 64> m_data{};
+    std::size_t m_size = 0;
+};
+
+class RecordReader {
+public:
+    RecordReader(const std::uint8_t* data, std::size_t size) : m_data(data), m_size(size) {}
+    
+    bool get(std::uint64_t& value, int bytes) {
+        if (m_offset + bytes > m_size) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= static_cast<std::uint64_t>(m_data[m_offset++]) << (8 * i);
+        }
+        return true;
+    }
+    std::uint8_t u8() { std::uint64_t v = 0; m_ok = get(v, 1) && m_ok; return static_cast<std::uint8_t>(v); }
+    std::uint32_t u32() { std::uint64_t v = 0; m_ok = get(v, 4) && m_ok; return static_cast<std::uint32_t>(v); }
+    std::uint64_t u64() { std::uint64_t v = 0; m_ok = get(v, 8) && m_ok; return v; }
+    std::int64_t i64() { return static_cast<std::int64_t>(u64()); }
+    bool ok() const { return m_ok; }
+    
+private:
+    const std::uint8_t* m_data;
+    std::size_t m_size;
+    std::size_t m_offset = 0;
+    bool m_ok = true;
+};
+
+void writeRoomStart(RecordWriter& writer, std::uint32_t roomId, const std::uint64_t tokens[2], const TimeControl& timeControl) {
+    writer.u8(static_cast<std::uint8_t>(RecordType::RoomStart));
+    writer.u32(roomId);
+    writer.u64(tokens[0]);
+    writer.u64(tokens[1]);
+    writer.u8(static_cast<std::uint8_t>(timeControl.type));
+    writer.i64(timeControl.initialMicros);
+    writer.i64(timeControl.incrementMicros);
+}
+
+void writeMove(RecordWriter& writer, std::uint32_t roomId, const JournaledMove& move) {
+    writer.u8(static_cast<std::uint8_t>(RecordType::Move));
+    writer.u32(roomId);
+    writer.u32(move.seq);
+    writer.u8(static_cast<std::uint8_t>(move.move.fromRow));
+    writer.u8(static_cast<std::uint8_t>(move.move.fromCol));
+    writer.u8(static_cast<std::uint8_t>(move.move.toRow));
+    writer.u8(static_cast<std::uint8_t>(move.move.toCol));
+    writer.i64(move.whiteMicros);
+    writer.i64(move.blackMicros);
+}
+
+void frameRecord(std::vector<std::uint8_t>& out, const std::uint8_t* payload, std::size_t size) {
+    RecordWriter header;
+    header.u32(static_cast<std::uint32_t>(size));
+    header.u32(crc32(payload, size));
+    out.insert(out.end(), header.data(), header.data() + header.size());
+    out.insert(out.end(), payload, payload + size);
+}
+
+bool syncFile(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+} // namespace
+
+GameJournal::~GameJournal() {
+    close();
+}
+
+bool GameJournal::open(const std::string& path, std::vector<JournaledRoom>& liveRooms) {
+    m_path = path;
+    liveRooms.clear();
+    
+    // Replay whatever an earlier run left behind
+    std::ifstream input(path, std::ios::binary);
+    if (input) {
+        std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        if (data.size() < sizeof(JOURNAL_MAGIC) || std::memcmp(data.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0) {
+            std::cerr << "Not a game journal: " << path << std::endl;
+            return false;
+        }
+        
+        std::map<std::uint32_t, JournaledRoom> rooms;
+        std::size_t offset = sizeof(JOURNAL_MAGIC);
+        std::size_t replayed = 0;
+        while (offset + 8 <= data.size()) {
+            RecordReader header(data.data() + offset, 8);
+            std::uint32_t size = header.u32();
+            std::uint32_t checksum = header.u32();
+            if (offset + 8 + size > data.size() || crc32(data.data() + offset + 8, size) != checksum) {
+                break;
+            }
+            
+            RecordReader record(data.data() + offset + 8, size);
+            RecordType type = static_cast<RecordType>(record.u8());
+            std::uint32_t roomId = record.u32();
+            if (type == RecordType::RoomStart) {
+                JournaledRoom& room = rooms[roomId];
+                room.roomId = roomId;
+                room.tokens[0] = record.u64();
+                room.tokens[1] = record.u64();
+                room.timeControl.type = static_cast<TimeControlType>(record.u8());
+                room.timeControl.initialMicros = record.i64();
+                room.timeControl.incrementMicros = record.i64();
+            } else if (type == RecordType::Move) {
+                JournaledMove move;
+                move.seq = record.u32();
+                move.move.fromRow = record.u8();
+                move.move.fromCol = record.u8();
+                move.move.toRow = record.u8();
+                move.move.toCol = record.u8();
+                move.whiteMicros = record.i64();
+                move.blackMicros = record.i64();
+                auto room = rooms.find(roomId);
+                if (room != rooms.end()) {
+                    room->second.moves.push_back(move);
+                }
+            } else if (type == RecordType::RoomEnd) {
+                rooms.erase(roomId);
+            }
+            if (!record.ok()) {
+                break;
+            }
+            offset += 8 + size;
+            replayed++;
+        }
+        
+        if (offset < data.size()) {
+            std::cerr << "Journal: discarding " << data.size() - offset << " bytes of torn or corrupt records" << std::endl;
+        }
+        for (auto& entry : rooms) {
+            liveRooms.push_back(std::move(entry.second));
+        }
+        std::cout << "Journal: replayed " << replayed << " records, " << liveRooms.size() << " games in progress" << std::endl;
+    }
+    
+    // Start over with only the live games; the commit thread compacts again as games finish
+    m_liveRooms.clear();
+    m_liveRecords = 0;
+    for (const JournaledRoom& room : liveRooms) {
+        m_liveRooms[room.roomId] = room;
+        m_liveRecords += 1 + room.moves.size();
+    }
+    if (!rewrite(liveRooms)) {
+        std::cerr << "Failed to write journal " << path << std::endl;
+        return false;
+    }
+    m_file = std::fopen(path.c_str(), "ab");
+    if (!m_file) {
+        std::cerr << "Failed to open journal " << path << std::endl;
+        return false;
+    }
+    
+    m_stopping = false;
+    m_commitThread = std::thread(&GameJournal::commitLoop, this);
+    return true;
+}
+
+void GameJournal::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    
+    // The commit thread writes out the last batch before it exits
+    if (m_commitThread.joinable()) {
+        m_commitThread.join();
+    }
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+bool GameJournal::rewrite(const std::vector<JournaledRoom>& liveRooms) {
+    std::vector<std::uint8_t> data(JOURNAL_MAGIC, JOURNAL_MAGIC + sizeof(JOURNAL_MAGIC));
+    for (const JournaledRoom& room : liveRooms) {
+        RecordWriter start;
+        writeRoomStart(start, room.roomId, room.tokens, room.timeControl);
+        frameRecord(data, start.data(), start.size());
+        for (const JournaledMove& move : room.moves) {
+            RecordWriter record;
+            writeMove(record, room.roomId, move);
+            frameRecord(data, record.data(), record.size());
+        }
+    }
+    
+    // Write a new file and swap it in, so a crash here leaves the old journal intact
+    std::string temporaryPath = m_path + ".tmp";
+    std::FILE* file = std::fopen(temporaryPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size() && syncFile(file);
+    std::fclose(file);
+    if (!written) {
+        return false;
+    }
+#ifdef _WIN32
+    std::remove(m_path.c_str());
+#endif
+    if (std::rename(temporaryPath.c_str(), m_path.c_str()) != 0) {
+        return false;
+    }
+    m_fileBytes = data.size();
+    return true;
+}
+
+bool GameJournal::compact(const std::vector<JournaledRoom>& liveRooms) {
+    // Closed first, as Windows cannot replace an open file
+    if (m_file) {
+        std::fclose(m_file);
+    }
+    bool rewritten = rewrite(liveRooms);
+    m_file = std::fopen(m_path.c_str(), "ab");
+    if (!m_file) {
+        std::cerr << "Journal: cannot reopen " << m_path << ", games will not survive a crash" << std::endl;
+    }
+    return rewritten;
+}
+
+void GameJournal::roomStarted(std::uint32_t roomId, const std::uint64_t tokens[2], const TimeControl& timeControl) {
+    RecordWriter record;
+    writeRoomStart(record, roomId, tokens, timeControl);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        JournaledRoom& room = m_liveRooms[roomId];
+        room.roomId = roomId;
+        room.tokens[0] = tokens[0];
+        room.tokens[1] = tokens[1];
+        room.timeControl = timeControl;
+        m_liveRecords++;
+        append(record.data(), record.size());
+    }
+    m_wake.notify_one();
+}
+
+void GameJournal::moveMade(std::uint32_t roomId, const JournaledMove& move) {
+    RecordWriter record;
+    writeMove(record, roomId, move);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto room = m_liveRooms.find(roomId);
+        if (room != m_liveRooms.end()) {
+            room->second.moves.push_back(move);
+            m_liveRecords++;
+        }
+        append(record.data(), record.size());
+    }
+    m_wake.notify_one();
+}
+
+void GameJournal::roomFinished(std::uint32_t roomId) {
+    RecordWriter record;
+    record.u8(static_cast<std::uint8_t>(RecordType::RoomEnd));
+    record.u32(roomId);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto room = m_liveRooms.find(roomId);
+        if (room != m_liveRooms.end()) {
+            m_liveRecords -= 1 + room->second.moves.size();
+            m_liveRooms.erase(room);
+        }
+        append(record.data(), record.size());
+    }
+    m_wake.notify_one();
+}
+
+void GameJournal::append(const std::uint8_t* payload, std::size_t size) {
+    frameRecord(m_pending, payload, size);
+    m_records++;
+}
+
+void GameJournal::commitLoop() {
+    std::vector<std::uint8_t> batch;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    
+    while (true) {
+        m_wake.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+        if (m_pending.empty()) {
+            break;
+        }
+        batch.swap(m_pending);
+        
+        // The live games already include the batch, so a compacted file replaces it
+        std::vector<JournaledRoom> liveRooms;
+        std::uint64_t size = m_fileBytes + batch.size();
+        bool compacting = size >= COMPACT_MIN_BYTES && size > 2 * m_liveRecords * MAX_RECORD_BYTES;
+        if (compacting) {
+            liveRooms.reserve(m_liveRooms.size());
+            for (const auto& entry : m_liveRooms) {
+                liveRooms.push_back(entry.second);
+            }
+        }
+        lock.unlock();
+        
+        // One write and one fsync for everything appended while the last one ran
+        if (!compacting || !compact(liveRooms)) {
+            if (!m_file || std::fwrite(batch.data(), 1, batch.size(), m_file) != batch.size() || !syncFile(m_file)) {
+                std::cerr << "Journal: write failed, games may not survive a crash" << std::endl;
+            }
+            m_fileBytes += batch.size();
+        }
+        m_commits++;
+        batch.clear();
+        
+        lock.lock();
+    }
+}
@@ -0,0 +1,782 @@
+#include "../include/GameServer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr std::int64_t STATS_INTERVAL_MICROS = 10000000;
+// Poller id of the listening socket; client ids start at 1
+constexpr std::uint32_t LISTENER_ID = 0;
+
+PieceColor opponentOf(PieceColor color) {
+    return color == PieceColor::White ? PieceColor::Black : PieceColor::White;
+}
+
+int sideIndex(PieceColor color) {
+    return color == PieceColor::White ? 0 : 1;
+}
+
+} // namespace
+
+GameServer::GameServer(const ServerOptions& options)
+    : m_options(options), m_running(false), m_timers(monotonicMicros()) {
+    // Session tokens let a connection take over a seat, so they must not be guessable
+    std::random_device device;
+    std::seed_seq seed{device(), device(), device(), device()};
+    m_tokenGenerator.seed(seed);
+}
+
+bool GameServer::start() {
+    // Pick up the games that were running when the server last stopped
+    if (!m_options.journalPath.empty()) {
+        std::vector<JournaledRoom> liveRooms;
+        m_journal = std::make_unique<GameJournal>();
+        if (!m_journal->open(m_options.journalPath, liveRooms)) {
+            return false;
+        }
+        for (const JournaledRoom& journaled : liveRooms) {
+            if (!restoreRoom(journaled)) {
+                std::cerr << "Journal: room " << journaled.roomId << " does not replay, abandoning it" << std::endl;
+                m_journal->roomFinished(journaled.roomId);
+            }
+        }
+    }
+    
+    if (m_listener.listen(m_options.port) != sf::Socket::Status::Done) {
+        std::cerr << "Failed to listen on port " << m_options.port << std::endl;
+        return false;
+    }
+    m_listener.setBlocking(false);
+    m_poller.add(m_listener, LISTENER_ID);
+    m_running = true;
+    
+    std::cout << "Server listening on port " << m_options.port << std::endl;
+    return true;
+}
+
+void GameServer::run() {
+    m_timers.schedule(monotonicMicros() + STATS_INTERVAL_MICROS, timerPayload(TimerKind::Stats, 0));
+    
+    while (m_running) {
+        // Sleep until a socket is ready or the next timer may be due; clients with
+        // unsent frames are retried soon, since only reads are polled for
+        std::int64_t maxWait = m_backlogged.empty() ? 50000 : 1000;
+        std::int64_t waitMicros = std::clamp<std::int64_t>(m_timers.microsUntilNextCheck(monotonicMicros()), 100, maxWait);
+        if (m_poller.wait(waitMicros)) {
+            for (std::uint32_t id : m_poller.getReady()) {
+                if (id == LISTENER_ID) {
+                    acceptClients();
+                } else if (Client* client = findClient(id)) {
+                    if (!client->dropped) {
+                        receiveFrom(*client);
+                    }
+                }
+            }
+        }
+        
+        std::int64_t now = monotonicMicros();
+        m_timers.advance(now, [this, now](std::uint64_t payload) {
+            onTimer(payload, now);
+        });
+        flushBacklogged();
+        processDrops();
+    }
+    
+    m_listener.close();
+}
+
+void GameServer::acceptClients() {
+    while (true) {
+        auto client = std::make_unique<Client>();
+        if (m_listener.accept(client->socket) != sf::Socket::Status::Done) {
+            break;
+        }
+        
+        client->id = m_nextClientId++;
+        client->socket.setBlocking(false);
+        m_poller.add(client->socket, client->id);
+        client->pingTimer = m_timers.schedule(monotonicMicros() + PING_INTERVAL_MICROS,
+                                              timerPayload(TimerKind::Ping, client->id));
+        // Nothing happens until the client says hello
+        m_clients.emplace(client->id, std::move(client));
+    }
+}
+
+void GameServer::receiveFrom(Client& client) {
+    while (!client.dropped) {
+        sf::Packet packet;
+        sf::Socket::Status status = client.socket.receive(packet);
+        
+        if (status == sf::Socket::Status::Done) {
+            std::int64_t receiveTime = monotonicMicros();
+            std::uint8_t type;
+            if (!(packet >> type)) {
+                continue;
+            }
+            
+            switch (static_cast<MessageType>(type)) {
+                case MessageType::Hello:
+                    handleHello(client, packet);
+                    break;
+                case MessageType::Move:
+                    handleMove(client, packet);
+                    break;
+                case MessageType::Ping:
+                    handlePing(client, packet, receiveTime);
+                    break;
+                case MessageType::Pong:
+                    handlePong(client, packet, receiveTime);
+                    break;
+                default:
+                    // Clients never send the other messages
+                    break;
+            }
+        } else if (status == sf::Socket::Status::Disconnected || status == sf::Socket::Status::Error) {
+            markDropped(client);
+        } else {
+            // Wait for the rest of the packet
+            break;
+        }
+    }
+}
+
+GameServer::Frame GameServer::makeFrame(const sf::Packet& packet) {
+    // Same layout as sf::TcpSocket::send(sf::Packet&): big-endian size, then the data
+    std::uint32_t size = static_cast<std::uint32_t>(packet.getDataSize());
+    auto frame = std::make_shared<std::vector<std::uint8_t>>(4 + size);
+    (*frame)[0] = static_cast<std::uint8_t>(size >> 24);
+    (*frame)[1] = static_cast<std::uint8_t>(size >> 16);
+    (*frame)[2] = static_cast<std::uint8_t>(size >> 8);
+    (*frame)[3] = static_cast<std::uint8_t>(size);
+    if (size > 0) {
+        std::memcpy(frame->data() + 4, packet.getData(), size);
+    }
+    return frame;
+}
+
+void GameServer::send(Client& client, const sf::Packet& packet) {
+    enqueue(client, makeFrame(packet), false);
+}
+
+void GameServer::enqueue(Client& client, const Frame& frame, bool droppable) {
+    if (client.dropped || (droppable && client.needsSnapshot)) {
+        return;
+    }
+    
+    std::size_t limit = client.spectator ? m_options.spectatorBacklogBytes : m_options.playerBacklogBytes;
+    if (client.outboxBytes > limit) {
+        if (!client.spectator) {
+            // A player that cannot keep up is better off resuming
+            markDropped(client);
+            return;
+        }
+        if (droppable) {
+            // Keep the frame being sent and anything final; a snapshot replaces the moves
+            std::deque<QueuedFrame> kept;
+            client.outboxBytes = 0;
+            for (QueuedFrame& queued : client.outbox) {
+                if (queued.offset > 0 || !queued.droppable) {
+                    client.outboxBytes += queued.frame->size() - queued.offset;
+                    kept.push_back(std::move(queued));
+                }
+            }
+            client.outbox.swap(kept);
+            client.needsSnapshot = true;
+            return;
+        }
+    }
+    
+    client.outbox.push_back({frame, 0, droppable});
+    client.outboxBytes += frame->size();
+    flush(client);
+}
+
+void GameServer::flush(Client& client) {
+    while (!client.dropped) {
+        if (client.outbox.empty()) {
+            auto room = m_rooms.find(client.watchRoomId);
+            if (!client.needsSnapshot || room == m_rooms.end()) {
+                break;
+            }
+            // Caught up: the current position stands in for the moves that were dropped
+            client.needsSnapshot = false;
+            client.outbox.push_back({spectateFrame(*room->second), 0, false});
+            if (room->second->clock.isTimed()) {
+                client.outbox.push_back({clockFrame(*room->second, monotonicMicros()), 0, true});
+            }
+            for (const QueuedFrame& queued : client.outbox) {
+                client.outboxBytes += queued.frame->size();
+            }
+            m_snapshotsSent++;
+        }
+        
+        QueuedFrame& front = client.outbox.front();
+        std::size_t remaining = front.frame->size() - front.offset;
+        std::size_t sent = 0;
+        sf::Socket::Status status = client.socket.send(front.frame->data() + front.offset, remaining, sent);
+        
+        if (status == sf::Socket::Status::Done) {
+            client.outboxBytes -= remaining;
+            client.outbox.pop_front();
+        } else if (status == sf::Socket::Status::Partial) {
+            front.offset += sent;
+            client.outboxBytes -= sent;
+            break;
+        } else if (status == sf::Socket::Status::NotReady) {
+            break;
+        } else {
+            markDropped(client);
+            break;
+        }
+    }
+    
+    if (client.outbox.empty() || client.dropped) {
+        m_backlogged.erase(client.id);
+    } else {
+        m_backlogged.insert(client.id);
+    }
+}
+
+void GameServer::flushBacklogged() {
+    // Flushing changes the set, so work from a copy
+    std::vector<std::uint32_t> backlogged(m_backlogged.begin(), m_backlogged.end());
+    for (std::uint32_t clientId : backlogged) {
+        if (Client* client = findClient(clientId)) {
+            flush(*client);
+        }
+    }
+}
+
+void GameServer::markDropped(Client& client) {
+    if (!client.dropped) {
+        client.dropped = true;
+        m_droppedClients.push_back(client.id);
+    }
+}
+
+void GameServer::processDrops() {
+    // Finishing a room can drop more clients, so walk the list by index
+    for (std::size_t i = 0; i < m_droppedClients.size(); i++) {
+        auto it = m_clients.find(m_droppedClients[i]);
+        if (it == m_clients.end()) {
+            continue;
+        }
+        Client& client = *it->second;
+        
+        if (m_waitingClient == client.id) {
+            m_waitingClient = 0;
+        }
+        // Hold the seat for a while; the game is lost if nobody reclaims it
+        auto room = m_rooms.find(client.roomId);
+        if (room != m_rooms.end()) {
+            int side = sideIndex(client.color);
+            Room& seat = *room->second;
+            seat.players[side] = 0;
+            seat.resumeTimers[side] = m_timers.schedule(monotonicMicros() + m_options.resumeWindowMicros,
+                                                        timerPayload(TimerKind::Resume, seat.id, side));
+            client.roomId = 0;
+        }
+        auto watched = m_rooms.find(client.watchRoomId);
+        if (watched != m_rooms.end()) {
+            watched->second->spectators.erase(client.id);
+            m_spectators--;
+        }
+        
+        m_backlogged.erase(client.id);
+        m_timers.cancel(client.pingTimer);
+        m_poller.remove(client.id);
+        client.socket.disconnect();
+        m_clients.erase(it);
+    }
+    m_droppedClients.clear();
+}
+
+void GameServer::handleHello(Client& client, sf::Packet& packet) {
+    HelloMessage hello;
+    if (client.greeted || !(packet >> hello)) {
+        return;
+    }
+    client.greeted = true;
+    
+    if (hello.spectate) {
+        addSpectator(client, hello.roomId);
+        return;
+    }
+    if (hello.sessionToken != 0) {
+        auto session = m_sessions.find(hello.sessionToken);
+        if (session == m_sessions.end()) {
+            // The game ended or the seat was given up
+            sf::Packet packet;
+            packet << static_cast<std::uint8_t>(MessageType::GameOver)
+                   << GameOverMessage{false, PieceColor::White, GameOverReason::Abandoned};
+            send(client, packet);
+            return;
+        }
+        Room& room = *m_rooms.at(session->second);
+        int side = room.tokens[0] == hello.sessionToken ? 0 : 1;
+        resumeSession(client, room, side, hello.lastEventSeq);
+        return;
+    }
+    
+    // First come, first served: pair with whoever is waiting
+    Client* waiting = findClient(m_waitingClient);
+    if (waiting && !waiting->dropped) {
+        m_waitingClient = 0;
+        startRoom(*waiting, client);
+    } else {
+        m_waitingClient = client.id;
+    }
+}
+
+void GameServer::handleMove(Client& client, sf::Packet& packet) {
+    int fromRow, fromCol, toRow, toCol;
+    if (!(packet >> fromRow >> fromCol >> toRow >> toCol)) {
+        return;
+    }
+    
+    // Only the side to move of a running game may move
+    auto it = m_rooms.find(client.roomId);
+    if (it == m_rooms.end() || it->second->current != client.color) {
+        return;
+    }
+    Room& room = *it->second;
+    
+    std::int64_t now = monotonicMicros();
+    std::int64_t lag = lagAllowance(client);
+    if (room.clock.isTimed() && room.clock.getRemaining(room.current, now) + lag < 0) {
+        finishRoom(room, {false, opponentOf(client.color), GameOverReason::Timeout});
+        return;
+    }
+    
+    Board::MoveResult result = room.board.applyMove(fromRow, fromCol, toRow, toCol, room.current);
+    if (!result.moved) {
+        // Illegal moves are dropped
+        return;
+    }
+    
+    // Relay the move to the opponent and everyone watching, serialized once
+    sf::Packet relay;
+    relay << static_cast<std::uint8_t>(MessageType::Move) << fromRow << fromCol << toRow << toCol;
+    Frame frame = makeFrame(relay);
+    if (Client* opponent = findClient(room.players[sideIndex(opponentOf(client.color))])) {
+        enqueue(*opponent, frame, false);
+    }
+    m_movesRelayed++;
+    
+    // The mover keeps the turn while a multi-capture continues
+    if (!result.canChain) {
+        room.clock.completeTurn(now, lag);
+        room.current = opponentOf(room.current);
+        room.moveCount++;
+    }
+    recordEvent(room, {fromRow, fromCol, toRow, toCol});
+    if (m_journal) {
+        m_journal->moveMade(room.id, {room.eventSeq, {fromRow, fromCol, toRow, toCol},
+                                      room.clock.getRemaining(PieceColor::White, now),
+                                      room.clock.getRemaining(PieceColor::Black, now)});
+    }
+    sendToSpectators(room, frame);
+    if (result.canChain) {
+        return;
+    }
+    
+    if (!room.board.hasLegalMove(room.current)) {
+        finishRoom(room, {false, client.color, GameOverReason::NoMoves});
+        return;
+    }
+    if (m_options.maxMoves > 0 && room.moveCount >= m_options.maxMoves) {
+        finishRoom(room, {true, PieceColor::White, GameOverReason::MoveLimit});
+        return;
+    }
+    
+    sendClock(room, now);
+    scheduleFlag(room);
+}
+
+void GameServer::handlePing(Client& client, sf::Packet& packet, std::int64_t receiveTime) {
+    std::uint32_t sequence;
+    std::int64_t originTime;
+    if (!(packet >> sequence >> originTime)) {
+        return;
+    }
+    
+    sf::Packet pong;
+    pong << static_cast<std::uint8_t>(MessageType::Pong) << sequence << originTime << receiveTime << monotonicMicros();
+    send(client, pong);
+}
+
+void GameServer::handlePong(Client& client, sf::Packet& packet, std::int64_t receiveTime) {
+    std::uint32_t sequence;
+    std::int64_t originTime, peerReceiveTime, peerTransmitTime;
+    if (packet >> sequence >> originTime >> peerReceiveTime >> peerTransmitTime) {
+        client.latency.addSample(originTime, peerReceiveTime, peerTransmitTime, receiveTime);
+    }
+}
+
+void GameServer::startRoom(Client& white, Client& black) {
+    std::uint32_t roomId = m_nextRoomId++;
+    auto inserted = m_rooms.emplace(roomId, std::make_unique<Room>(roomId, m_options.timeControl));
+    Room& room = *inserted.first->second;
+    
+    room.players[0] = white.id;
+    room.players[1] = black.id;
+    room.tokens[0] = newSessionToken();
+    room.tokens[1] = newSessionToken();
+    m_sessions[room.tokens[0]] = roomId;
+    m_sessions[room.tokens[1]] = roomId;
+    if (m_journal) {
+        m_journal->roomStarted(roomId, room.tokens, m_options.timeControl);
+    }
+    white.roomId = roomId;
+    white.color = PieceColor::White;
+    black.roomId = roomId;
+    black.color = PieceColor::Black;
+    
+    for (Client* player : {&white, &black}) {
+        sf::Packet packet;
+        packet << static_cast<std::uint8_t>(MessageType::GameStart)
+               << GameStartMessage{player->color, m_options.timeControl, room.tokens[sideIndex(player->color)], roomId};
+        send(*player, packet);
+    }
+    
+    std::int64_t now = monotonicMicros();
+    room.clock.start(PieceColor::White, now);
+    sendClock(room, now);
+    scheduleFlag(room);
+}
+
+bool GameServer::restoreRoom(const JournaledRoom& journaled) {
+    auto room = std::make_unique<Room>(journaled.roomId, journaled.timeControl);
+    
+    // Replay the moves through the rules, exactly as they were played
+    bool midChain = false;
+    for (const JournaledMove& move : journaled.moves) {
+        const Board::Move& hop = move.move;
+        Board::MoveResult result = room->board.applyMove(hop.fromRow, hop.fromCol, hop.toRow, hop.toCol, room->current);
+        if (!result.moved) {
+            return false;
+        }
+        midChain = result.canChain;
+        if (!result.canChain) {
+            room->current = opponentOf(room->current);
+            room->moveCount++;
+        }
+        recordEvent(*room, hop);
+    }
+    
+    // Time spent while the server was down is not charged to anyone
+    std::int64_t now = monotonicMicros();
+    if (journaled.moves.empty()) {
+        room->clock.start(PieceColor::White, now);
+    } else {
+        room->clock.restore(journaled.moves.back().whiteMicros, journaled.moves.back().blackMicros, room->current, now);
+    }
+    
+    // Both seats wait for their players to resume
+    for (int side = 0; side < 2; side++) {
+        room->tokens[side] = journaled.tokens[side];
+        m_sessions[journaled.tokens[side]] = journaled.roomId;
+        room->resumeTimers[side] = m_timers.schedule(now + m_options.resumeWindowMicros,
+                                                     timerPayload(TimerKind::Resume, journaled.roomId, side));
+    }
+    
+    Room& restored = *room;
+    m_rooms.emplace(journaled.roomId, std::move(room));
+    m_nextRoomId = std::max(m_nextRoomId, journaled.roomId + 1);
+    
+    // The last move may have ended the game before the result reached the journal
+    if (!midChain && !restored.board.hasLegalMove(restored.current)) {
+        finishRoom(restored, {false, opponentOf(restored.current), GameOverReason::NoMoves});
+        return true;
+    }
+    if (!midChain && m_options.maxMoves > 0 && restored.moveCount >= m_options.maxMoves) {
+        finishRoom(restored, {true, PieceColor::White, GameOverReason::MoveLimit});
+        return true;
+    }
+    scheduleFlag(restored);
+    return true;
+}
+
+void GameServer::addSpectator(Client& client, std::uint32_t roomId) {
+    // Room 0 means the newest game
+    auto room = m_rooms.find(roomId);
+    if (roomId == 0) {
+        room = std::max_element(m_rooms.begin(), m_rooms.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+    }
+    if (room == m_rooms.end()) {
+        sf::Packet packet;
+        packet << static_cast<std::uint8_t>(MessageType::GameOver)
+               << GameOverMessage{false, PieceColor::White, GameOverReason::Abandoned};
+        send(client, packet);
+        return;
+    }
+    
+    Room& watched = *room->second;
+    client.spectator = true;
+    client.watchRoomId = watched.id;
+    watched.spectators.insert(client.id);
+    m_spectators++;
+    
+    enqueue(client, spectateFrame(watched), false);
+    if (watched.clock.isTimed()) {
+        enqueue(client, clockFrame(watched, monotonicMicros()), true);
+    }
+}
+
+void GameServer::sendToSpectators(Room& room, const Frame& frame) {
+    for (std::uint32_t spectatorId : room.spectators) {
+        if (Client* spectator = findClient(spectatorId)) {
+            enqueue(*spectator, frame, true);
+        }
+    }
+}
+
+GameServer::Frame GameServer::spectateFrame(Room& room) {
+    if (!room.snapshotFrame) {
+        SpectateMessage message;
+        message.roomId = room.id;
+        message.timeControl = room.clock.getTimeControl();
+        message.eventSeq = room.eventSeq;
+        message.position = room.board.getPosition(room.current);
+        message.moveCount = room.moveCount;
+        
+        sf::Packet packet;
+        packet << static_cast<std::uint8_t>(MessageType::Spectate) << message;
+        room.snapshotFrame = makeFrame(packet);
+    }
+    return room.snapshotFrame;
+}
+
+GameServer::Frame GameServer::clockFrame(const Room& room, std::int64_t now) const {
+    ClockMessage clock{room.clock.getRemaining(PieceColor::White, now),
+                       room.clock.getRemaining(PieceColor::Black, now),
+                       room.current};
+    sf::Packet packet;
+    packet << static_cast<std::uint8_t>(MessageType::ClockUpdate) << clock;
+    return makeFrame(packet);
+}
+
+void GameServer::resumeSession(Client& client, Room& room, int side, std::uint32_t lastEventSeq) {
+    // An old connection that never noticed it was dead gives way to the new one
+    if (Client* previous = findClient(room.players[side])) {
+        previous->roomId = 0;
+        markDropped(*previous);
+    }
+    m_timers.cancel(room.resumeTimers[side]);
+    room.resumeTimers[side] = 0;
+    
+    room.players[side] = client.id;
+    client.roomId = room.id;
+    client.color = side == 0 ? PieceColor::White : PieceColor::Black;
+    m_gamesResumed++;
+    
+    sf::Packet packet;
+    packet << static_cast<std::uint8_t>(MessageType::Resync) << buildResync(room, side, lastEventSeq);
+    send(client, packet);
+    
+    sendClock(room, monotonicMicros());
+    scheduleFlag(room);
+}
+
+ResyncMessage GameServer::buildResync(const Room& room, int side, std::uint32_t lastEventSeq) const {
+    ResyncMessage resync;
+    resync.color = side == 0 ? PieceColor::White : PieceColor::Black;
+    resync.timeControl = room.clock.getTimeControl();
+    resync.sessionToken = room.tokens[side];
+    
+    // Replay from what the client last saw when the buffer reaches back that far;
+    // otherwise (or when the client is ahead of us) the current position is the base
+    auto base = room.events.end();
+    bool fromStart = lastEventSeq == 0 && !room.events.empty() && room.events.front().seq == 1;
+    if (lastEventSeq < room.eventSeq && !fromStart) {
+        base = std::find_if(room.events.begin(), room.events.end(), [lastEventSeq](const RoomEvent& event) {
+            return event.seq == lastEventSeq;
+        });
+    }
+    
+    if (fromStart) {
+        resync.baseSeq = 0;
+        resync.position = room.startPosition;
+        resync.moveCount = 0;
+        for (const RoomEvent& event : room.events) {
+            resync.moves.push_back(event.move);
+        }
+    } else if (base != room.events.end()) {
+        resync.baseSeq = base->seq;
+        resync.position = base->positionAfter;
+        resync.moveCount = base->moveCountAfter;
+        for (auto it = std::next(base); it != room.events.end(); ++it) {
+            resync.moves.push_back(it->move);
+        }
+    } else {
+        resync.baseSeq = room.eventSeq;
+        resync.position = room.board.getPosition(room.current);
+        resync.moveCount = room.moveCount;
+    }
+    return resync;
+}
+
+void GameServer::recordEvent(Room& room, const Board::Move& move) {
+    room.events.push_back({++room.eventSeq, move, room.board.getPosition(room.current), room.moveCount});
+    if (room.events.size() > m_options.resumeBufferEvents) {
+        room.events.pop_front();
+    }
+    room.snapshotFrame.reset();
+}
+
+std::uint64_t GameServer::newSessionToken() {
+    std::uint64_t token;
+    do {
+        token = m_tokenGenerator();
+    } while (token == 0 || m_sessions.count(token) != 0);
+    return token;
+}
+
+void GameServer::sendClock(Room& room, std::int64_t now) {
+    if (!room.clock.isTimed()) {
+        return;
+    }
+    
+    Frame frame = clockFrame(room, now);
+    for (std::uint32_t playerId : room.players) {
+        if (Client* player = findClient(playerId)) {
+            enqueue(*player, frame, false);
+        }
+    }
+    sendToSpectators(room, frame);
+}
+
+void GameServer::scheduleFlag(Room& room) {
+    if (!room.clock.isTimed()) {
+        return;
+    }
+    
+    m_timers.cancel(room.flagTimer);
+    std::int64_t deadline = room.clock.getFlagTime();
+    if (Client* mover = findClient(room.players[sideIndex(room.current)])) {
+        deadline += lagAllowance(*mover);
+    }
+    room.flagTimer = m_timers.schedule(deadline, timerPayload(TimerKind::Flag, room.id));
+}
+
+void GameServer::checkFlag(Room& room, std::int64_t now) {
+    // The lag allowance may have changed since the timer was set
+    std::int64_t remaining = room.clock.getRemaining(room.current, now);
+    if (Client* mover = findClient(room.players[sideIndex(room.current)])) {
+        remaining += lagAllowance(*mover);
+    }
+    
+    if (remaining < 0) {
+        finishRoom(room, {false, opponentOf(room.current), GameOverReason::Timeout});
+    } else {
+        scheduleFlag(room);
+    }
+}
+
+void GameServer::finishRoom(Room& room, const GameOverMessage& result) {
+    sf::Packet packet;
+    packet << static_cast<std::uint8_t>(MessageType::GameOver) << result;
+    Frame frame = makeFrame(packet);
+    
+    for (std::uint32_t playerId : room.players) {
+        Client* player = findClient(playerId);
+        if (player && player->roomId == room.id) {
+            enqueue(*player, frame, false);
+            player->roomId = 0;
+        }
+    }
+    // Spectators always learn the result, however far behind they are
+    for (std::uint32_t spectatorId : room.spectators) {
+        if (Client* spectator = findClient(spectatorId)) {
+            spectator->needsSnapshot = false;
+            enqueue(*spectator, frame, false);
+            spectator->watchRoomId = 0;
+            m_spectators--;
+        }
+    }
+    
+    m_timers.cancel(room.flagTimer);
+    for (int side = 0; side < 2; side++) {
+        m_timers.cancel(room.resumeTimers[side]);
+        m_sessions.erase(room.tokens[side]);
+    }
+    if (m_journal) {
+        m_journal->roomFinished(room.id);
+    }
+    m_gamesFinished++;
+    m_rooms.erase(room.id);
+}
+
+std::int64_t GameServer::lagAllowance(const Client& client) const {
+    // The move travels to us and our clock update travels back before the mover's
+    // clock visibly starts, so a full round trip is not charged to the mover
+    std::int64_t roundTrip = static_cast<std::int64_t>(client.latency.getStats().smoothedRttMs * 1000.0);
+    return std::min(roundTrip, m_options.maxLagCompensationMicros);
+}
+
+GameServer::Client* GameServer::findClient(std::uint32_t clientId) {
+    auto it = m_clients.find(clientId);
+    return it != m_clients.end() ? it->second.get() : nullptr;
+}
+
+std::uint64_t GameServer::timerPayload(TimerKind kind, std::uint32_t id, std::uint32_t side) {
+    return (static_cast<std::uint64_t>(kind) << 56) | (static_cast<std::uint64_t>(side) << 32) | id;
+}
+
+void GameServer::onTimer(std::uint64_t payload, std::int64_t now) {
+    TimerKind kind = static_cast<TimerKind>(payload >> 56);
+    int side = static_cast<int>((payload >> 32) & 0xFF);
+    std::uint32_t id = static_cast<std::uint32_t>(payload & 0xFFFFFFFF);
+    
+    switch (kind) {
+        case TimerKind::Ping: {
+            Client* client = findClient(id);
+            if (!client || client->dropped) {
+                break;
+            }
+            sf::Packet packet;
+            packet << static_cast<std::uint8_t>(MessageType::Ping) << client->nextPingSequence++ << now;
+            send(*client, packet);
+            client->latency.countPingSent();
+            client->pingTimer = m_timers.schedule(now + PING_INTERVAL_MICROS, timerPayload(TimerKind::Ping, id));
+            break;
+        }
+        case TimerKind::Flag: {
+            auto it = m_rooms.find(id);
+            if (it != m_rooms.end()) {
+                it->second->flagTimer = 0;
+                checkFlag(*it->second, now);
+            }
+            break;
+        }
+        case TimerKind::Resume: {
+            // Nobody reclaimed the seat in time
+            auto it = m_rooms.find(id);
+            if (it != m_rooms.end() && it->second->players[side] == 0) {
+                it->second->resumeTimers[side] = 0;
+                PieceColor leaver = side == 0 ? PieceColor::White : PieceColor::Black;
+                finishRoom(*it->second, {false, opponentOf(leaver), GameOverReason::Disconnect});
+            }
+            break;
+        }
+        case TimerKind::Stats:
+            std::cout << "clients " << m_clients.size()
+                      << ", rooms " << m_rooms.size()
+                      << ", games finished " << m_gamesFinished
+                      << ", games resumed " << m_gamesResumed
+                      << ", spectators " << m_spectators
+                      << ", snapshots " << m_snapshotsSent
+                      << ", moves relayed " << m_movesRelayed
+                      << ", timers " << m_timers.size();
+            if (m_journal) {
+                std::cout << ", journal records " << m_journal->getRecords()
+                          << " in " << m_journal->getCommits() << " commits";
+            }
+            std::cout << std::endl;
+            m_timers.schedule(now + STATS_INTERVAL_MICROS, timerPayload(TimerKind::Stats, 0));
+            break;
+    }
+}
@@ -0,0 +1,477 @@
+#include "../include/GameStore.hpp"
+#include "../include/Engine.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+const char STORE_MAGIC[4] = {'C', 'K', 'D', 'B'};
+constexpr std::uint32_t STORE_VERSION = 1;
+constexpr std::size_t BATCH_GAMES = 256;
+constexpr std::uint8_t ESCAPE_INDEX = 255;
+
+// Fixed-size file header, stored in native (little-endian) byte order
+struct StoreHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t gameCount;
+    std::uint64_t moveBytes;
+    std::uint64_t indexSize;
+    std::uint64_t offsetsStart;
+    std::uint64_t resultsStart;
+    std::uint64_t movesStart;
+    std::uint64_t hashesStart;
+    std::uint64_t idsStart;
+};
+
+void collectTurns(const Position& position, PdnMove& path, std::vector<PdnMove>& turns) {
+    std::vector<Hop> hops;
+    EngineRules::generateHops(position, position.getSideToMove(), hops);
+    for (const Hop& hop : hops) {
+        Position next = position;
+        bool chain = EngineRules::applyHop(next, hop);
+        std::uint8_t count = path.count;
+        if (path.count == 0) {
+            path.squares[path.count++] = static_cast<std::uint8_t>(hop.from);
+        }
+        path.squares[path.count++] = static_cast<std::uint8_t>(hop.to);
+        path.capture = hop.captured >= 0;
+        if (chain && path.count < path.squares.size()) {
+            collectTurns(next, path, turns);
+        } else {
+            turns.push_back(path);
+        }
+        path.count = count;
+    }
+}
+
+// Plays a turn from generateTurns()
+void applyTurn(Position& position, const PdnMove& turn) {
+    for (int i = 1; i < turn.count; i++) {
+        Hop hop;
+        if (EngineRules::findHop(position, turn.squares[i - 1], turn.squares[i], hop)) {
+            EngineRules::applyHop(position, hop);
+        }
+    }
+}
+
+bool isSameTurn(const PdnMove& turn, const PdnMove& move) {
+    return turn.count == move.count &&
+           std::equal(turn.squares.begin(), turn.squares.begin() + turn.count, move.squares.begin());
+}
+
+// Whether a move as written (possibly just the first and last square of a capture) describes the turn
+bool matchesTurn(const PdnMove& turn, const PdnMove& move) {
+    if (turn.squares[0] != move.squares[0] || turn.squares[turn.count - 1] != move.squares[move.count - 1]) {
+        return false;
+    }
+    int next = 1;
+    for (int i = 1; i < turn.count - 1 && next < move.count - 1; i++) {
+        if (turn.squares[i] == move.squares[next]) {
+            next++;
+        }
+    }
+    return next == move.count - 1;
+}
+
+bool writeColumn(std::FILE* file, const void* data, std::size_t bytes) {
+    return bytes == 0 || std::fwrite(data, 1, bytes, file) == bytes;
+}
+
+std::uint64_t alignTo8(std::uint64_t offset) {
+    return (offset + 7) & ~std::uint64_t(7);
+}
+
+} // namespace
+
+void generateTurns(const Position& position, std::vector<PdnMove>& turns) {
+    turns.clear();
+    PdnMove path;
+    collectTurns(position, path, turns);
+    std::sort(turns.begin(), turns.end(), [](const PdnMove& a, const PdnMove& b) {
+        return std::lexicographical_compare(a.squares.begin(), a.squares.begin() + a.count,
+                                            b.squares.begin(), b.squares.begin() + b.count);
+    });
+}
+
+bool GameStore::open(const std::string& path) {
+    close();
+    if (!m_file.open(path)) {
+        std::cerr << "Cannot open game store " << path << std::endl;
+        return false;
+    }
+
+    StoreHeader header;
+    const std::uint8_t* data = m_file.getData();
+    std::uint64_t size = m_file.getSize();
+    if (size < sizeof(header)) {
+        std::cerr << "Not a game store: " << path << std::endl;
+        m_file.close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    bool valid = std::memcmp(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC)) == 0 &&
+                 header.version == STORE_VERSION &&
+                 header.offsetsStart % 8 == 0 && header.hashesStart % 8 == 0 && header.idsStart % 4 == 0 &&
+                 header.offsetsStart + (header.gameCount + 1) * 8 <= size &&
+                 header.resultsStart + header.gameCount <= size &&
+                 header.movesStart + header.moveBytes <= size &&
+                 header.hashesStart + header.indexSize * 8 <= size &&
+                 header.idsStart + header.indexSize * 4 <= size;
+    if (!valid) {
+        std::cerr << "Not a game store or unsupported version: " << path << std::endl;
+        m_file.close();
+        return false;
+    }
+
+    m_gameCount = header.gameCount;
+    m_moveBytes = header.moveBytes;
+    m_indexSize = header.indexSize;
+    m_offsets = reinterpret_cast<const std::uint64_t*>(data + header.offsetsStart);
+    m_results = data + header.resultsStart;
+    m_moves = data + header.movesStart;
+    m_hashes = reinterpret_cast<const std::uint64_t*>(data + header.hashesStart);
+    m_ids = reinterpret_cast<const std::uint32_t*>(data + header.idsStart);
+    return true;
+}
+
+void GameStore::close() {
+    m_file.close();
+    m_gameCount = 0;
+    m_moveBytes = 0;
+    m_indexSize = 0;
+    m_offsets = nullptr;
+    m_results = nullptr;
+    m_moves = nullptr;
+    m_hashes = nullptr;
+    m_ids = nullptr;
+}
+
+PdnResult GameStore::getResult(std::uint32_t gameId) const {
+    if (gameId >= m_gameCount || m_results[gameId] > static_cast<std::uint8_t>(PdnResult::Draw)) {
+        return PdnResult::Unknown;
+    }
+    return static_cast<PdnResult>(m_results[gameId]);
+}
+
+bool GameStore::getGame(std::uint32_t gameId, PdnGame& game) {
+    game.clear();
+    if (gameId >= m_gameCount) {
+        return false;
+    }
+    game.result = getResult(gameId);
+
+    Position current = Position::initial();
+    std::uint64_t end = std::min(m_offsets[gameId + 1], m_moveBytes);
+    for (std::uint64_t position = m_offsets[gameId]; position < end;) {
+        std::size_t index = m_moves[position++];
+        if (index == ESCAPE_INDEX) {
+            if (position + 2 > end) {
+                return false;
+            }
+            index = m_moves[position] | (std::size_t(m_moves[position + 1]) << 8);
+            position += 2;
+        }
+        generateTurns(current, m_turns);
+        if (index >= m_turns.size()) {
+            return false;
+        }
+        game.moves.push_back(m_turns[index]);
+        applyTurn(current, m_turns[index]);
+    }
+    return true;
+}
+
+std::pair<const std::uint64_t*, const std::uint64_t*> GameStore::findRange(std::uint64_t hash) const {
+    return std::equal_range(m_hashes, m_hashes + m_indexSize, hash);
+}
+
+std::vector<std::uint32_t> GameStore::findGames(const Position& position, std::size_t limit) const {
+    auto range = findRange(position.hash());
+    std::size_t count = std::min(static_cast<std::size_t>(range.second - range.first), limit);
+    const std::uint32_t* ids = m_ids + (range.first - m_hashes);
+    return std::vector<std::uint32_t>(ids, ids + count);
+}
+
+std::size_t GameStore::countGames(const Position& position) const {
+    auto range = findRange(position.hash());
+    return static_cast<std::size_t>(range.second - range.first);
+}
+
+GameStoreBuilder::GameStoreBuilder(unsigned int threads)
+    : m_threads(std::max(1u, threads)) {
+}
+
+void GameStoreBuilder::encodeBatch(const std::vector<PdnGame>& games, EncodedBatch& batch) {
+    const Position initial = Position::initial();
+    std::vector<PdnMove> turns;
+    std::vector<std::size_t> matches;
+    std::vector<std::uint64_t> hashes;
+
+    for (const PdnGame& game : games) {
+        std::size_t gameStart = batch.moves.size();
+        std::string error = game.error;
+        if (error.empty() && game.start != initial) {
+            error = "games from set-up positions are not stored";
+        }
+
+        Position position = initial;
+        hashes.clear();
+        for (std::size_t i = 0; i < game.moves.size() && error.empty(); i++) {
+            generateTurns(position, turns);
+            matches.clear();
+            for (std::size_t t = 0; t < turns.size(); t++) {
+                if (isSameTurn(turns[t], game.moves[i])) {
+                    matches.assign(1, t);
+                    break;
+                }
+                if (matchesTurn(turns[t], game.moves[i])) {
+                    matches.push_back(t);
+                }
+            }
+            // Shorthand captures may fit several paths; fine as long as they end in the same position
+            if (matches.size() > 1) {
+                Position first = position;
+                applyTurn(first, turns[matches[0]]);
+                for (std::size_t m = 1; m < matches.size() && error.empty(); m++) {
+                    Position other = position;
+                    applyTurn(other, turns[matches[m]]);
+                    if (other != first) {
+                        error = "ambiguous move " + std::to_string(i / 2 + 1);
+                    }
+                }
+            } else if (matches.empty()) {
+                error = "illegal move " + std::to_string(i / 2 + 1);
+            }
+            if (!error.empty()) {
+                break;
+            }
+
+            std::size_t index = matches[0];
+            if (index < ESCAPE_INDEX) {
+                batch.moves.push_back(static_cast<std::uint8_t>(index));
+            } else {
+                batch.moves.push_back(ESCAPE_INDEX);
+                batch.moves.push_back(static_cast<std::uint8_t>(index));
+                batch.moves.push_back(static_cast<std::uint8_t>(index >> 8));
+            }
+            applyTurn(position, turns[index]);
+            hashes.push_back(position.hash());
+        }
+
+        if (!error.empty()) {
+            batch.moves.resize(gameStart);
+            batch.skipped++;
+            if (batch.firstError.empty()) {
+                batch.firstError = error;
+            }
+            continue;
+        }
+
+        // A position repeated within a game is indexed once
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+        std::uint32_t gameNumber = static_cast<std::uint32_t>(batch.results.size());
+        for (std::uint64_t hash : hashes) {
+            batch.positions.push_back({hash, gameNumber});
+        }
+        batch.results.push_back(static_cast<std::uint8_t>(game.result));
+        batch.gameEnds.push_back(batch.moves.size());
+    }
+}
+
+void GameStoreBuilder::sortIndex(std::vector<IndexEntry>& index) const {
+    // Hashes are uniform, so splitting on the top byte gives buckets of similar size
+    // that sort independently
+    std::vector<std::size_t> bucketStart(257, 0);
+    for (const IndexEntry& entry : index) {
+        bucketStart[(entry.hash >> 56) + 1]++;
+    }
+    for (std::size_t bucket = 1; bucket < bucketStart.size(); bucket++) {
+        bucketStart[bucket] += bucketStart[bucket - 1];
+    }
+    std::vector<IndexEntry> sorted(index.size());
+    std::vector<std::size_t> fill(bucketStart.begin(), bucketStart.end() - 1);
+    for (const IndexEntry& entry : index) {
+        sorted[fill[entry.hash >> 56]++] = entry;
+    }
+    index.clear();
+    index.shrink_to_fit();
+
+    std::atomic<std::size_t> nextBucket{0};
+    auto sortBuckets = [&]() {
+        for (std::size_t bucket; (bucket = nextBucket++) < 256;) {
+            std::sort(sorted.begin() + bucketStart[bucket], sorted.begin() + bucketStart[bucket + 1],
+                      [](const IndexEntry& a, const IndexEntry& b) {
+                          return a.hash < b.hash || (a.hash == b.hash && a.gameId < b.gameId);
+                      });
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < m_threads; i++) {
+        workers.emplace_back(sortBuckets);
+    }
+    sortBuckets();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    index.swap(sorted);
+}
+
+bool GameStoreBuilder::build(std::istream& pdn, const std::string& path) {
+    struct Job {
+        std::vector<PdnGame> games;
+        EncodedBatch* output;
+    };
+
+    // Batches are encoded out of order but kept in input order, so game ids follow the archive
+    std::deque<EncodedBatch> batches;
+    std::deque<Job> jobs;
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable spaceAvailable;
+    bool finished = false;
+    std::size_t maxQueued = 2 * m_threads;
+
+    auto work = [&]() {
+        while (true) {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [&] { return finished || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            spaceAvailable.notify_one();
+            encodeBatch(job.games, *job.output);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < m_threads; i++) {
+        workers.emplace_back(work);
+    }
+
+    // Parse on this thread; the workers replay the moves, which is where the time goes
+    PdnReader reader(pdn);
+    reader.setValidate(false);
+    while (true) {
+        std::vector<PdnGame> games(BATCH_GAMES);
+        std::size_t count = 0;
+        while (count < games.size() && reader.next(games[count])) {
+            count++;
+        }
+        games.resize(count);
+        if (games.empty()) {
+            break;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            spaceAvailable.wait(lock, [&] { return jobs.size() < maxQueued; });
+            batches.emplace_back();
+            jobs.push_back({std::move(games), &batches.back()});
+        }
+        workAvailable.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    m_bytesRead = reader.getBytesRead();
+
+    // Stitch the batches together
+    std::vector<std::uint64_t> offsets(1, 0);
+    std::vector<std::uint8_t> results;
+    std::vector<std::uint8_t> moves;
+    std::vector<IndexEntry> index;
+    int errorsShown = 0;
+    for (EncodedBatch& batch : batches) {
+        std::uint32_t firstGame = static_cast<std::uint32_t>(results.size());
+        std::uint64_t moveBase = moves.size();
+        for (std::uint64_t end : batch.gameEnds) {
+            offsets.push_back(moveBase + end);
+        }
+        moves.insert(moves.end(), batch.moves.begin(), batch.moves.end());
+        results.insert(results.end(), batch.results.begin(), batch.results.end());
+        for (const IndexEntry& entry : batch.positions) {
+            index.push_back({entry.hash, firstGame + entry.gameId});
+        }
+        m_skipped += batch.skipped;
+        if (!batch.firstError.empty() && errorsShown++ < 10) {
+            std::cerr << "Skipping game: " << batch.firstError << std::endl;
+        }
+        batch = EncodedBatch();
+    }
+    if (results.size() > UINT32_MAX) {
+        std::cerr << "Too many games for one store" << std::endl;
+        return false;
+    }
+    m_games = results.size();
+    m_moves = moves.size();
+    m_indexSize = index.size();
+    sortIndex(index);
+
+    StoreHeader header{};
+    std::memcpy(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+    header.version = STORE_VERSION;
+    header.gameCount = m_games;
+    header.moveBytes = moves.size();
+    header.indexSize = index.size();
+    header.offsetsStart = sizeof(StoreHeader);
+    header.resultsStart = header.offsetsStart + offsets.size() * 8;
+    header.movesStart = header.resultsStart + results.size();
+    header.hashesStart = alignTo8(header.movesStart + moves.size());
+    header.idsStart = header.hashesStart + index.size() * 8;
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Cannot create " << path << std::endl;
+        return false;
+    }
+    const std::uint8_t padding[8] = {};
+    bool written = writeColumn(file, &header, sizeof(header)) &&
+                   writeColumn(file, offsets.data(), offsets.size() * 8) &&
+                   writeColumn(file, results.data(), results.size()) &&
+                   writeColumn(file, moves.data(), moves.size()) &&
+                   writeColumn(file, padding, header.hashesStart - (header.movesStart + moves.size()));
+
+    // The index is split into its two columns a chunk at a time
+    std::vector<std::uint64_t> hashChunk;
+    std::vector<std::uint32_t> idChunk;
+    const std::size_t chunkSize = 1 << 16;
+    for (std::size_t start = 0; written && start < index.size(); start += chunkSize) {
+        std::size_t end = std::min(index.size(), start + chunkSize);
+        hashChunk.clear();
+        for (std::size_t i = start; i < end; i++) {
+            hashChunk.push_back(index[i].hash);
+        }
+        written = writeColumn(file, hashChunk.data(), hashChunk.size() * 8);
+    }
+    for (std::size_t start = 0; written && start < index.size(); start += chunkSize) {
+        std::size_t end = std::min(index.size(), start + chunkSize);
+        idChunk.clear();
+        for (std::size_t i = start; i < end; i++) {
+            idChunk.push_back(index[i].gameId);
+        }
+        written = writeColumn(file, idChunk.data(), idChunk.size() * 4);
+    }
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        std::cerr << "Failed to write " << path << std::endl;
+        std::remove(path.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#include "../include/LatencyEstimator.hpp"
+#include <algorithm>
+#include <cmath>
+
+void LatencyEstimator::reset() {
+    m_stats = LatencyStats();
+    m_sampleCount = 0;
+}
+
+void LatencyEstimator::addSample(std::int64_t originTime, std::int64_t peerReceiveTime,
+                                 std::int64_t peerTransmitTime, std::int64_t receiveTime) {
+    // Round trip without the time the peer held the ping, and the NTP clock offset estimate
+    double delayMs = ((receiveTime - originTime) - (peerTransmitTime - peerReceiveTime)) / 1000.0;
+    double offsetMs = ((peerReceiveTime - originTime) + (peerTransmitTime - receiveTime)) / 2000.0;
+    delayMs = std::max(delayMs, 0.0);
+    
+    // Like NTP's clock filter, trust the offset of the fastest recent exchange
+    m_samples[m_sampleCount % m_samples.size()] = {delayMs, offsetMs};
+    m_sampleCount++;
+    std::size_t sampleCount = std::min(m_sampleCount, m_samples.size());
+    const ClockSample* best = &m_samples[0];
+    for (std::size_t i = 1; i < sampleCount; i++) {
+        if (m_samples[i].delayMs < best->delayMs) {
+            best = &m_samples[i];
+        }
+    }
+    
+    if (m_stats.pongsReceived == 0) {
+        m_stats.smoothedRttMs = delayMs;
+        m_stats.rttJitterMs = delayMs / 2;
+        m_stats.minRttMs = delayMs;
+    } else {
+        // Smoothed RTT and variation as TCP computes them
+        m_stats.rttJitterMs = 0.75 * m_stats.rttJitterMs + 0.25 * std::abs(m_stats.smoothedRttMs - delayMs);
+        m_stats.smoothedRttMs = 0.875 * m_stats.smoothedRttMs + 0.125 * delayMs;
+        m_stats.minRttMs = std::min(m_stats.minRttMs, delayMs);
+    }
+    m_stats.lastRttMs = delayMs;
+    m_stats.clockOffsetMs = best->offsetMs;
+    m_stats.pongsReceived++;
+}
@@ -0,0 +1,247 @@
+#include "../include/Network.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NETWORK_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+using Geometry = tables::Geometry8;
+using Bits = Geometry::Bits;
+
+constexpr int HIDDEN = Network::HIDDEN;
+
+void addRow(std::int16_t* values, const std::int16_t* row) {
+#if defined(__AVX2__)
+    for (int i = 0; i < HIDDEN; i += 16) {
+        __m256i sum = _mm256_add_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), sum);
+    }
+#elif defined(NETWORK_SSE2)
+    for (int i = 0; i < HIDDEN; i += 8) {
+        __m128i sum = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), sum);
+    }
+#else
+    for (int i = 0; i < HIDDEN; i++) {
+        values[i] = static_cast<std::int16_t>(values[i] + row[i]);
+    }
+#endif
+}
+
+void subtractRow(std::int16_t* values, const std::int16_t* row) {
+#if defined(__AVX2__)
+    for (int i = 0; i < HIDDEN; i += 16) {
+        __m256i difference = _mm256_sub_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)),
+                                              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), difference);
+    }
+#elif defined(NETWORK_SSE2)
+    for (int i = 0; i < HIDDEN; i += 8) {
+        __m128i difference = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), difference);
+    }
+#else
+    for (int i = 0; i < HIDDEN; i++) {
+        values[i] = static_cast<std::int16_t>(values[i] - row[i]);
+    }
+#endif
+}
+
+// Clamps count values to [0, ACTIVATION_MAX]
+void activate(const std::int16_t* values, std::int16_t* out, int count) {
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i top = _mm256_set1_epi16(Network::ACTIVATION_MAX);
+    for (int i = 0; i < count; i += 16) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_min_epi16(_mm256_max_epi16(value, zero), top));
+    }
+#elif defined(NETWORK_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i top = _mm_set1_epi16(Network::ACTIVATION_MAX);
+    for (int i = 0; i < count; i += 8) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_min_epi16(_mm_max_epi16(value, zero), top));
+    }
+#else
+    for (int i = 0; i < count; i++) {
+        out[i] = std::min<std::int16_t>(std::max<std::int16_t>(values[i], 0), Network::ACTIVATION_MAX);
+    }
+#endif
+}
+
+// Activations are at most 127, so 256 products stay well inside 32 bits
+std::int32_t dot(const std::int16_t* a, const std::int16_t* b, int count) {
+#if defined(__AVX2__)
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < count; i += 16) {
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+#elif defined(NETWORK_SSE2)
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < count; i += 8) {
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                                _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    std::int32_t sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += static_cast<std::int32_t>(a[i]) * b[i];
+    }
+    return sum;
+#endif
+}
+
+struct FileHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t inputs;
+    std::uint32_t hidden;
+    std::uint32_t outputs1;
+};
+
+template <typename T>
+bool readArray(std::istream& input, std::vector<T>& values) {
+    return static_cast<bool>(input.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(T)));
+}
+
+template <typename T>
+void writeArray(std::ostream& output, const std::vector<T>& values) {
+    output.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+} // namespace
+
+Network::Network()
+    : m_featureWeights(INPUTS * HIDDEN),
+      m_featureBiases(HIDDEN),
+      m_hiddenWeights(OUTPUTS1 * 2 * HIDDEN),
+      m_hiddenBiases(OUTPUTS1),
+      m_outputWeights(OUTPUTS1) {
+}
+
+bool Network::load(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        std::cerr << "Cannot open network " << path << std::endl;
+        return false;
+    }
+    FileHeader header{};
+    input.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!input || std::string(header.magic, 4) != "CKNN") {
+        std::cerr << "Not a network file: " << path << std::endl;
+        return false;
+    }
+    if (header.version != FILE_VERSION || header.inputs != INPUTS || header.hidden != HIDDEN ||
+        header.outputs1 != OUTPUTS1) {
+        std::cerr << "Unsupported network version or shape in " << path << std::endl;
+        return false;
+    }
+    Network loaded;
+    if (!readArray(input, loaded.m_featureWeights) || !readArray(input, loaded.m_featureBiases) ||
+        !readArray(input, loaded.m_hiddenWeights) || !readArray(input, loaded.m_hiddenBiases) ||
+        !readArray(input, loaded.m_outputWeights) ||
+        !input.read(reinterpret_cast<char*>(&loaded.m_outputBias), sizeof(loaded.m_outputBias))) {
+        std::cerr << "Truncated network file: " << path << std::endl;
+        return false;
+    }
+    *this = std::move(loaded);
+    return true;
+}
+
+bool Network::save(const std::string& path) const {
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    FileHeader header{{'C', 'K', 'N', 'N'}, FILE_VERSION, INPUTS, HIDDEN, OUTPUTS1};
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(output, m_featureWeights);
+    writeArray(output, m_featureBiases);
+    writeArray(output, m_hiddenWeights);
+    writeArray(output, m_hiddenBiases);
+    writeArray(output, m_outputWeights);
+    output.write(reinterpret_cast<const char*>(&m_outputBias), sizeof(m_outputBias));
+    if (!output.flush()) {
+        std::cerr << "Cannot write network " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int Network::feature(int view, const Position& position, int square) {
+    Bits bit = Geometry::bit(square);
+    int type = ((position.white & bit) ? 0 : 2) + ((position.kings & bit) ? 1 : 0);
+    if (view == 1) {
+        // Black's pieces become "own" and the board is turned around
+        type ^= 2;
+        square = Geometry::SQUARES - 1 - square;
+    }
+    return type * Geometry::SQUARES + square;
+}
+
+void Network::addFeature(NnueAccumulator& accumulator, const Position& position, int square) const {
+    for (int view = 0; view < 2; view++) {
+        addRow(accumulator.values[view].data(), &m_featureWeights[feature(view, position, square) * HIDDEN]);
+    }
+}
+
+void Network::removeFeature(NnueAccumulator& accumulator, const Position& position, int square) const {
+    for (int view = 0; view < 2; view++) {
+        subtractRow(accumulator.values[view].data(), &m_featureWeights[feature(view, position, square) * HIDDEN]);
+    }
+}
+
+void Network::refresh(const Position& position, NnueAccumulator& accumulator) const {
+    for (auto& values : accumulator.values) {
+        std::copy(m_featureBiases.begin(), m_featureBiases.end(), values.begin());
+    }
+    for (Bits pieces = position.getOccupied(); pieces; pieces &= pieces - 1) {
+        addFeature(accumulator, position, lowestSquare(pieces));
+    }
+}
+
+void Network::update(NnueAccumulator& accumulator, const Position& before, const Hop& hop, const Position& after) const {
+    removeFeature(accumulator, before, hop.from);
+    addFeature(accumulator, after, hop.to);
+    if (hop.captured >= 0) {
+        removeFeature(accumulator, before, hop.captured);
+    }
+}
+
+int Network::evaluate(const Position& position, const NnueAccumulator& accumulator) const {
+    // Side to move's view first
+    int own = position.blackToMove ? 1 : 0;
+    alignas(32) std::int16_t input[2 * HIDDEN];
+    activate(accumulator.values[own].data(), input, HIDDEN);
+    activate(accumulator.values[1 - own].data(), input + HIDDEN, HIDDEN);
+
+    std::int32_t output = m_outputBias;
+    for (int i = 0; i < OUTPUTS1; i++) {
+        std::int32_t sum = m_hiddenBiases[i] + dot(input, &m_hiddenWeights[i * 2 * HIDDEN], 2 * HIDDEN);
+        std::int32_t hidden = std::min(std::max(sum >> WEIGHT_SHIFT, 0), ACTIVATION_MAX);
+        output += hidden * m_outputWeights[i];
+    }
+    return output >> WEIGHT_SHIFT;
+}
+
+int Network::evaluate(const Position& position) const {
+    NnueAccumulator accumulator;
+    refresh(position, accumulator);
+    return evaluate(position, accumulator);
+}
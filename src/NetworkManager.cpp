@@ -1,7 +1,30 @@
 #include "../include/NetworkManager.hpp"
+#include <algorithm>
+#include <sstream>
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
+
+namespace {
+
+// Unsent bytes a peer may leave queued before it counts as gone
+constexpr std::size_t MAX_OUTBOX_BYTES = 1024 * 1024;
+
+// select() only takes descriptors below FD_SETSIZE (on Windows it limits the count
+// instead), so a process holding more files than that cannot wait on the socket
+bool canSelect(const sf::TcpSocket& socket) {
+#ifdef _WIN32
+    (void)socket;
+    return true;
+#else
+    return socket.getNativeHandle() < FD_SETSIZE;
+#endif
+}
+
+} // namespace
 
 NetworkManager::NetworkManager() 
-    : m_status(NetworkStatus::Disconnected), m_running(false) {
+    : m_status(NetworkStatus::Disconnected), m_running(false), m_eventCount(0) {
     // Set socket to non-blocking mode
     m_socket.setBlocking(false);
 }
@@ -48,6 +71,18 @@ void NetworkManager::stopHosting() {
 }
 
 bool NetworkManager::connectToGame(const std::string& ip, unsigned short port) {
+    m_spectating = false;
+    m_watchRoomId = 0;
+    return openConnection(ip, port);
+}
+
+bool NetworkManager::watchGame(const std::string& ip, unsigned short port, std::uint32_t roomId) {
+    m_spectating = true;
+    m_watchRoomId = roomId;
+    return openConnection(ip, port);
+}
+
+bool NetworkManager::openConnection(const std::string& ip, unsigned short port) {
     // Make sure we're not already connected
     if (m_status != NetworkStatus::Disconnected) {
         return false;
@@ -71,6 +106,22 @@ bool NetworkManager::connectToGame(const std::string& ip, unsigned short port) {
     // Connected successfully
     updateStatus(NetworkStatus::Connected, "Connected to host");
     m_running = true;
+    {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        m_outbox.clear();
+    }
+    
+    // A fresh connection starts a fresh session; game servers pair us up on the hello
+    m_remoteIp = ip;
+    m_remotePort = port;
+    {
+        std::lock_guard<std::mutex> lock(m_serverMutex);
+        m_sessionToken = 0;
+        m_hasResync = false;
+        m_hasSpectate = false;
+    }
+    m_eventCount = 0;
+    sendHello();
     
     // Start receive thread
     m_receiveThread = std::thread(&NetworkManager::receiveData, this);
@@ -103,14 +154,51 @@ bool NetworkManager::sendMove(int fromRow, int fromCol, int toRow, int toCol) {
     
     // Package the move data
     sf::Packet packet;
-    packet << fromRow << fromCol << toRow << toCol;
+    packet << static_cast<std::uint8_t>(MessageType::Move) << fromRow << fromCol << toRow << toCol;
     
-    // Send the data
-    if (m_socket.send(packet) != sf::Socket::Status::Done) {
-        updateStatus(NetworkStatus::Disconnected, "Failed to send move");
+    if (!sendPacket(packet)) {
+        // A server game is resumed by the receive thread, which resyncs the lost move
+        std::lock_guard<std::mutex> lock(m_serverMutex);
+        if (m_sessionToken == 0) {
+            updateStatus(NetworkStatus::Disconnected, "Failed to send move");
+        }
+        return false;
+    }
+    
+    m_eventCount++;
+    return true;
+}
+
+bool NetworkManager::sendPacket(sf::Packet& packet) {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    if (m_outbox.size() > MAX_OUTBOX_BYTES) {
         return false;
     }
     
+    // Same layout as sf::TcpSocket::send(sf::Packet&): big-endian size, then the data
+    std::uint32_t size = static_cast<std::uint32_t>(packet.getDataSize());
+    const std::uint8_t* data = static_cast<const std::uint8_t*>(packet.getData());
+    m_outbox.push_back(static_cast<std::uint8_t>(size >> 24));
+    m_outbox.push_back(static_cast<std::uint8_t>(size >> 16));
+    m_outbox.push_back(static_cast<std::uint8_t>(size >> 8));
+    m_outbox.push_back(static_cast<std::uint8_t>(size));
+    m_outbox.insert(m_outbox.end(), data, data + size);
+    return flushOutbox();
+}
+
+bool NetworkManager::flushOutbox() {
+    // A full send buffer is not an error: the receive thread sends the rest later
+    while (!m_outbox.empty()) {
+        std::size_t sent = 0;
+        sf::Socket::Status status = m_socket.send(m_outbox.data(), m_outbox.size(), sent);
+        m_outbox.erase(m_outbox.begin(), m_outbox.begin() + static_cast<std::ptrdiff_t>(sent));
+        if (status == sf::Socket::Status::Disconnected || status == sf::Socket::Status::Error) {
+            return false;
+        }
+        if (status != sf::Socket::Status::Done) {
+            break;
+        }
+    }
     return true;
 }
 
@@ -136,9 +224,80 @@ NetworkStatus NetworkManager::getStatus() const {
 }
 
 std::string NetworkManager::getStatusText() const {
+    std::lock_guard<std::mutex> lock(m_statusMutex);
     return m_statusMessage;
 }
 
+bool NetworkManager::takeGameStart(GameStartMessage& message) {
+    std::lock_guard<std::mutex> lock(m_serverMutex);
+    if (!m_hasGameStart) {
+        return false;
+    }
+    message = m_gameStart;
+    m_hasGameStart = false;
+    return true;
+}
+
+bool NetworkManager::getClock(ClockMessage& clock, std::int64_t& receivedAt) const {
+    std::lock_guard<std::mutex> lock(m_serverMutex);
+    if (!m_hasClock) {
+        return false;
+    }
+    clock = m_clock;
+    receivedAt = m_clockReceivedAt;
+    return true;
+}
+
+bool NetworkManager::takeGameOver(GameOverMessage& message) {
+    std::lock_guard<std::mutex> lock(m_serverMutex);
+    if (!m_hasGameOver) {
+        return false;
+    }
+    message = m_gameOver;
+    m_hasGameOver = false;
+    return true;
+}
+
+bool NetworkManager::takeSpectate(SpectateMessage& message) {
+    std::lock_guard<std::mutex> lock(m_serverMutex);
+    if (!m_hasSpectate) {
+        return false;
+    }
+    message = m_spectate;
+    m_hasSpectate = false;
+    return true;
+}
+
+bool NetworkManager::takeResync(ResyncMessage& message) {
+    std::lock_guard<std::mutex> lock(m_serverMutex);
+    if (!m_hasResync) {
+        return false;
+    }
+    message = m_resync;
+    m_hasResync = false;
+    return true;
+}
+
+LatencyStats NetworkManager::getLatencyStats() const {
+    std::lock_guard<std::mutex> lock(m_latencyMutex);
+    return m_latency.getStats();
+}
+
+std::string NetworkManager::getMetricsText() const {
+    LatencyStats latency = getLatencyStats();
+    
+    // Prometheus text exposition format
+    std::ostringstream text;
+    text << "checkers_net_rtt_ms{stat=\"last\"} " << latency.lastRttMs << "\n"
+         << "checkers_net_rtt_ms{stat=\"smoothed\"} " << latency.smoothedRttMs << "\n"
+         << "checkers_net_rtt_ms{stat=\"min\"} " << latency.minRttMs << "\n"
+         << "checkers_net_rtt_jitter_ms " << latency.rttJitterMs << "\n"
+         << "checkers_net_clock_offset_ms " << latency.clockOffsetMs << "\n"
+         << "checkers_net_pings_sent_total " << latency.pingsSent << "\n"
+         << "checkers_net_pongs_received_total " << latency.pongsReceived << "\n";
+    return text.str();
+}
+
 std::string NetworkManager::getLocalIpAddress() const {
     // Get the local IP address
     auto localIpOpt = sf::IpAddress::getLocalAddress();
@@ -158,6 +317,10 @@ void NetworkManager::listenForConnections() {
         if (m_listener.accept(m_socket) == sf::Socket::Status::Done) {
             // Client connected!
             updateStatus(NetworkStatus::Connected, "Opponent connected!");
+            {
+                std::lock_guard<std::mutex> lock(m_sendMutex);
+                m_outbox.clear();
+            }
             
             // Stop listening for new connections
             m_listener.close();
@@ -177,32 +340,252 @@ void NetworkManager::receiveData() {
     // Set socket to non-blocking mode
     m_socket.setBlocking(false);
     
+    // Fresh latency estimates for every connection
+    {
+        std::lock_guard<std::mutex> lock(m_latencyMutex);
+        m_latency.reset();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_serverMutex);
+        m_hasGameStart = false;
+        m_hasClock = false;
+        m_hasGameOver = false;
+        m_hasResync = false;
+        m_hasSpectate = false;
+    }
+    m_lastPingTime = 0;
+    
+    // Wait on the socket instead of sleeping, so packets are handled as soon as they arrive;
+    // a socket the selector cannot hold is polled instead
+    sf::SocketSelector selector;
+    bool selectable = canSelect(m_socket);
+    if (selectable) {
+        selector.add(m_socket);
+    }
+    
     while (m_running && m_status == NetworkStatus::Connected) {
+        // Ping the peer periodically
+        std::int64_t now = monotonicMicros();
+        if (now - m_lastPingTime >= PING_INTERVAL_MICROS) {
+            sendPing(now);
+        }
+        {
+            // A failure here shows up as a disconnect when receiving
+            std::lock_guard<std::mutex> lock(m_sendMutex);
+            flushOutbox();
+        }
+        
+        if (selectable && !selector.wait(sf::milliseconds(10))) {
+            continue;
+        }
+        
         // Receive packets
         sf::Packet packet;
         sf::Socket::Status status = m_socket.receive(packet);
+        std::int64_t receiveTime = monotonicMicros();
         
         if (status == sf::Socket::Status::Done) {
             // Process received packet
-            int fromRow, fromCol, toRow, toCol;
-            if (packet >> fromRow >> fromCol >> toRow >> toCol) {
-                // Add to move queue
-                std::lock_guard<std::mutex> lock(m_movesMutex);
-                m_receivedMoves.push({fromRow, fromCol, toRow, toCol});
+            std::uint8_t type;
+            if (!(packet >> type)) {
+                continue;
+            }
+            
+            switch (static_cast<MessageType>(type)) {
+                case MessageType::Move: {
+                    int fromRow, fromCol, toRow, toCol;
+                    if (packet >> fromRow >> fromCol >> toRow >> toCol) {
+                        // Add to move queue
+                        std::lock_guard<std::mutex> lock(m_movesMutex);
+                        m_receivedMoves.push({fromRow, fromCol, toRow, toCol});
+                        m_eventCount++;
+                    }
+                    break;
+                }
+                case MessageType::Ping:
+                    handlePing(packet, receiveTime);
+                    break;
+                case MessageType::Pong:
+                    handlePong(packet, receiveTime);
+                    break;
+                case MessageType::GameStart: {
+                    GameStartMessage message;
+                    if (packet >> message) {
+                        std::lock_guard<std::mutex> lock(m_serverMutex);
+                        m_gameStart = message;
+                        m_hasGameStart = true;
+                        m_sessionToken = message.sessionToken;
+                        m_eventCount = 0;
+                    }
+                    break;
+                }
+                case MessageType::ClockUpdate: {
+                    ClockMessage message;
+                    if (packet >> message) {
+                        std::lock_guard<std::mutex> lock(m_serverMutex);
+                        m_clock = message;
+                        m_clockReceivedAt = receiveTime;
+                        m_hasClock = true;
+                    }
+                    break;
+                }
+                case MessageType::GameOver: {
+                    GameOverMessage message;
+                    if (packet >> message) {
+                        // Nothing left to resume
+                        std::lock_guard<std::mutex> lock(m_serverMutex);
+                        m_gameOver = message;
+                        m_hasGameOver = true;
+                        m_sessionToken = 0;
+                        m_watchRoomId = 0;
+                    }
+                    break;
+                }
+                case MessageType::Resync: {
+                    ResyncMessage message;
+                    if (packet >> message) {
+                        // The resync replaces whatever the game has not applied yet
+                        std::lock_guard<std::mutex> movesLock(m_movesMutex);
+                        std::lock_guard<std::mutex> lock(m_serverMutex);
+                        while (!m_receivedMoves.empty()) {
+                            m_receivedMoves.pop();
+                        }
+                        m_resync = message;
+                        m_hasResync = true;
+                        m_sessionToken = message.sessionToken;
+                        m_eventCount = message.baseSeq + static_cast<std::uint32_t>(message.moves.size());
+                    }
+                    break;
+                }
+                case MessageType::Spectate: {
+                    SpectateMessage message;
+                    if (packet >> message) {
+                        // The position already includes every move still queued
+                        std::lock_guard<std::mutex> movesLock(m_movesMutex);
+                        std::lock_guard<std::mutex> lock(m_serverMutex);
+                        while (!m_receivedMoves.empty()) {
+                            m_receivedMoves.pop();
+                        }
+                        m_spectate = message;
+                        m_hasSpectate = true;
+                        m_watchRoomId = message.roomId;
+                    }
+                    break;
+                }
+                default:
+                    // Ignore messages we don't know about
+                    break;
             }
         } 
         else if (status == sf::Socket::Status::Disconnected) {
-            // Connection lost
-            updateStatus(NetworkStatus::Disconnected, "Opponent disconnected");
-            break;
+            // Connection lost; a server game can be picked up again
+            if (!resumeSession(selector)) {
+                updateStatus(NetworkStatus::Disconnected, "Opponent disconnected");
+                break;
+            }
+            selectable = canSelect(m_socket);
+        }
+        else if (status == sf::Socket::Status::NotReady && !selectable) {
+            // Nothing has arrived; poll again shortly
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+bool NetworkManager::resumeSession(sf::SocketSelector& selector) {
+    {
+        std::lock_guard<std::mutex> lock(m_serverMutex);
+        if (m_sessionToken == 0 && (!m_spectating || m_watchRoomId == 0)) {
+            // Peer-to-peer and finished games cannot be resumed
+            return false;
+        }
+    }
+    
+    auto address = sf::IpAddress::resolve(m_remoteIp);
+    if (!address) {
+        return false;
+    }
+    updateStatus(NetworkStatus::Reconnecting, "Connection lost, reconnecting...");
+    
+    // Retry with exponential backoff for as long as the server holds our seat
+    std::int64_t giveUpAt = monotonicMicros() + RESUME_WINDOW_MICROS;
+    int backoffMs = 100;
+    while (m_running && monotonicMicros() < giveUpAt) {
+        sf::Socket::Status status;
+        {
+            std::lock_guard<std::mutex> lock(m_sendMutex);
+            selector.clear();
+            m_outbox.clear();
+            m_socket.disconnect();
+            status = m_socket.connect(*address, m_remotePort, sf::seconds(2));
+            m_socket.setBlocking(false);
+            if (canSelect(m_socket)) {
+                selector.add(m_socket);
+            }
         }
         
-        // Sleep to avoid maxing out CPU
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (status == sf::Socket::Status::Done && sendHello()) {
+            updateStatus(NetworkStatus::Connected, "Reconnected");
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+        backoffMs = std::min(backoffMs * 2, 2000);
     }
+    return false;
+}
+
+bool NetworkManager::sendHello() {
+    HelloMessage hello;
+    {
+        std::lock_guard<std::mutex> lock(m_serverMutex);
+        hello.sessionToken = m_sessionToken;
+        hello.roomId = m_watchRoomId;
+    }
+    hello.lastEventSeq = m_eventCount;
+    hello.spectate = m_spectating;
+    
+    sf::Packet packet;
+    packet << static_cast<std::uint8_t>(MessageType::Hello) << hello;
+    return sendPacket(packet);
+}
+
+void NetworkManager::sendPing(std::int64_t now) {
+    sf::Packet packet;
+    packet << static_cast<std::uint8_t>(MessageType::Ping) << m_nextPingSequence++ << now;
+    m_lastPingTime = now;
+    
+    if (sendPacket(packet)) {
+        std::lock_guard<std::mutex> lock(m_latencyMutex);
+        m_latency.countPingSent();
+    }
+}
+
+void NetworkManager::handlePing(sf::Packet& packet, std::int64_t receiveTime) {
+    std::uint32_t sequence;
+    std::int64_t originTime;
+    if (!(packet >> sequence >> originTime)) {
+        return;
+    }
+    
+    // Echo the sender's timestamp together with ours, as in NTP
+    sf::Packet pong;
+    pong << static_cast<std::uint8_t>(MessageType::Pong) << sequence << originTime << receiveTime << monotonicMicros();
+    sendPacket(pong);
+}
+
+void NetworkManager::handlePong(sf::Packet& packet, std::int64_t receiveTime) {
+    std::uint32_t sequence;
+    std::int64_t originTime, peerReceiveTime, peerTransmitTime;
+    if (!(packet >> sequence >> originTime >> peerReceiveTime >> peerTransmitTime)) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_latencyMutex);
+    m_latency.addSample(originTime, peerReceiveTime, peerTransmitTime, receiveTime);
 }
 
 void NetworkManager::updateStatus(NetworkStatus status, const std::string& message) {
+    std::lock_guard<std::mutex> lock(m_statusMutex);
     m_status = status;
     m_statusMessage = message;
 } 
\ No newline at end of file
@@ -0,0 +1,543 @@
+#include "../include/Pdn.hpp"
+#include "../include/Engine.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+constexpr int END_OF_INPUT = -1;
+
+// Character classes, looked up once per byte while scanning the buffer
+constexpr std::uint8_t DELIMITER = 1;   // ends a token
+constexpr std::uint8_t SKIPPED = 2;     // passed over between tokens
+constexpr std::uint8_t DIGIT = 4;
+constexpr std::uint8_t LETTER = 8;
+constexpr std::uint8_t ANNOTATION = 16;  // "!", "?" and "*" after a move, "+" in some files
+
+struct CharClasses {
+    std::uint8_t classes[256] = {};
+
+    CharClasses() {
+        for (int c = 0; c < 256; c++) {
+            if (std::isspace(c)) {
+                classes[c] = DELIMITER | SKIPPED;
+            } else if (std::isdigit(c)) {
+                classes[c] = DIGIT;
+            } else if (std::isalpha(c)) {
+                classes[c] = LETTER;
+            }
+        }
+        for (unsigned char c : {'{', '(', ';', '['}) {
+            classes[c] = DELIMITER;
+        }
+        for (unsigned char c : {'}', ')', ']'}) {
+            classes[c] = DELIMITER | SKIPPED;
+        }
+        for (unsigned char c : {'!', '?', '*', '+'}) {
+            classes[c] = ANNOTATION;
+        }
+    }
+
+    bool is(char c, std::uint8_t charClass) const {
+        return classes[static_cast<unsigned char>(c)] & charClass;
+    }
+};
+
+const CharClasses CHAR_CLASSES;
+
+bool parseResult(std::string_view text, PdnResult& result) {
+    if (text == "2-0" || text == "1-0") {
+        result = PdnResult::WhiteWins;
+    } else if (text == "0-2" || text == "0-1") {
+        result = PdnResult::BlackWins;
+    } else if (text == "1-1" || text == "1/2-1/2") {
+        result = PdnResult::Draw;
+    } else if (text == "*") {
+        result = PdnResult::Unknown;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool isDelimiter(int c) {
+    return c == END_OF_INPUT || CHAR_CLASSES.is(static_cast<char>(c), DELIMITER);
+}
+
+// A legal hop from-to for the side to move: captures are compulsory, and a multi-capture
+// goes on with the same piece
+bool findLegalHop(const Position& position, int from, int to, Hop& hop) {
+    PieceColor side = position.getSideToMove();
+    if (!EngineRules::findHop(position, from, to, hop) || !(position.getPieces(side) & (1u << from))) {
+        return false;
+    }
+    if (position.chainSquare >= 0) {
+        return from == position.chainSquare && hop.captured >= 0;
+    }
+    return hop.captured >= 0 || !EngineRules::hasCapture(position, side);
+}
+
+// Plays a move given with its full path; every listed square but the last has to
+// continue the capture
+bool applyExact(Position& position, const PdnMove& move) {
+    Position after = position;
+    for (int i = 1; i < move.count; i++) {
+        Hop hop;
+        if (!findLegalHop(after, move.squares[i - 1], move.squares[i], hop) ||
+            EngineRules::applyHop(after, hop) != (i + 1 < move.count)) {
+            return false;
+        }
+    }
+    position = after;
+    return true;
+}
+
+struct PathSearch {
+    const PdnMove& move;
+    PdnMove path;
+    PdnMove found;
+    Position foundPosition;
+    int solutions = 0;
+};
+
+// Looks for sequences of hops by the piece on the path's last square that pass through
+// the remaining listed squares in order and end the move on the last one. Stops once
+// two of them lead to different positions: the notation is then ambiguous.
+void searchPath(const Position& position, PathSearch& search, int next) {
+    const PdnMove& move = search.move;
+    PdnMove& path = search.path;
+    int from = path.squares[path.count - 1];
+    std::vector<Hop> hops;
+    EngineRules::generateHops(position, position.getSideToMove(), hops);
+    for (const Hop& hop : hops) {
+        if (hop.from != from) {
+            continue;
+        }
+        Position after = position;
+        bool chain = EngineRules::applyHop(after, hop);
+
+        int to = hop.to;
+        int matched = next < move.count && to == move.squares[next] ? next + 1 : next;
+        path.squares[path.count++] = static_cast<std::uint8_t>(to);
+        path.capture = hop.captured >= 0;
+        if (!chain) {
+            if (matched == move.count && to == move.squares[move.count - 1]) {
+                if (search.solutions == 0) {
+                    search.found = path;
+                    search.foundPosition = after;
+                    search.solutions = 1;
+                } else if (after != search.foundPosition) {
+                    search.solutions = 2;
+                }
+            }
+        } else if (path.count < path.squares.size()) {
+            searchPath(after, search, matched);
+        }
+        path.count--;
+        if (search.solutions > 1) {
+            return;
+        }
+    }
+}
+
+std::string moveText(const PdnMove& move) {
+    std::string text;
+    for (int i = 0; i < move.count; i++) {
+        if (i > 0) {
+            text += move.capture ? 'x' : '-';
+        }
+        text += squareName(move.squares[i]);
+    }
+    return text;
+}
+
+} // namespace
+
+void PdnGame::clear() {
+    tags.clear();
+    moves.clear();
+    annotations.clear();
+    result = PdnResult::Unknown;
+    error.clear();
+    start = Position::initial();
+}
+
+const std::string* PdnGame::getTag(const std::string& name) const {
+    for (const auto& tag : tags) {
+        if (tag.first == name) {
+            return &tag.second;
+        }
+    }
+    return nullptr;
+}
+
+void PdnGame::setTag(const std::string& name, const std::string& value) {
+    for (auto& tag : tags) {
+        if (tag.first == name) {
+            tag.second = value;
+            return;
+        }
+    }
+    tags.emplace_back(name, value);
+}
+
+PdnReader::PdnReader(std::istream& input, std::size_t bufferSize)
+    : m_input(input), m_buffer(bufferSize) {
+}
+
+bool PdnReader::refill() {
+    m_input.read(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_end = static_cast<std::size_t>(m_input.gcount());
+    m_position = 0;
+    m_bytesRead += m_end;
+    return m_end > 0;
+}
+
+int PdnReader::peek() {
+    if (m_position == m_end && !refill()) {
+        return END_OF_INPUT;
+    }
+    return static_cast<unsigned char>(m_buffer[m_position]);
+}
+
+int PdnReader::get() {
+    int c = peek();
+    if (c != END_OF_INPUT) {
+        m_position++;
+    }
+    return c;
+}
+
+void PdnReader::skipLine() {
+    while (m_position < m_end || refill()) {
+        const char* begin = m_buffer.data() + m_position;
+        const void* newline = std::memchr(begin, '\n', m_end - m_position);
+        if (newline) {
+            m_position += static_cast<const char*>(newline) - begin + 1;
+            return;
+        }
+        m_position = m_end;
+    }
+}
+
+void PdnReader::skipComment() {
+    while (m_position < m_end || refill()) {
+        const char* begin = m_buffer.data() + m_position;
+        const void* close = std::memchr(begin, '}', m_end - m_position);
+        if (close) {
+            m_position += static_cast<const char*>(close) - begin + 1;
+            return;
+        }
+        m_position = m_end;
+    }
+}
+
+void PdnReader::skipVariation() {
+    // Variations nest and may contain comments with unbalanced parentheses
+    int depth = 0;
+    int c;
+    while ((c = get()) != END_OF_INPUT) {
+        if (c == '{') {
+            skipComment();
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')' && --depth == 0) {
+            return;
+        }
+    }
+}
+
+void PdnReader::skipSpace() {
+    while (m_position < m_end || refill()) {
+        const char* data = m_buffer.data();
+        while (m_position < m_end && CHAR_CLASSES.is(data[m_position], SKIPPED)) {
+            m_position++;
+        }
+        if (m_position < m_end) {
+            return;
+        }
+    }
+}
+
+void PdnReader::readToken() {
+    // Tokens are only copied when they run past the end of the buffer
+    bool spilled = false;
+    while (true) {
+        const char* data = m_buffer.data();
+        std::size_t start = m_position;
+        while (m_position < m_end && !CHAR_CLASSES.is(data[m_position], DELIMITER)) {
+            m_position++;
+        }
+        if (m_position < m_end) {
+            if (!spilled) {
+                m_token = std::string_view(data + start, m_position - start);
+                return;
+            }
+            m_spill.append(data + start, m_position - start);
+            break;
+        }
+        if (!spilled) {
+            m_spill.clear();
+            spilled = true;
+        }
+        m_spill.append(data + start, m_position - start);
+        if (!refill()) {
+            break;
+        }
+    }
+    m_token = m_spill;
+}
+
+void PdnReader::readTag(PdnGame& game) {
+    get();  // '['
+    skipSpace();
+    std::string name;
+    while (!isDelimiter(peek()) && peek() != '"') {
+        name += static_cast<char>(get());
+    }
+    while (peek() == ' ' || peek() == '\t') {
+        get();
+    }
+
+    std::string value;
+    if (peek() == '"') {
+        get();
+        int c;
+        while ((c = get()) != END_OF_INPUT && c != '"' && c != '\n') {
+            if (c == '\\' && (peek() == '"' || peek() == '\\')) {
+                c = get();
+            }
+            value += static_cast<char>(c);
+        }
+    }
+    // Whatever else is left up to the closing bracket
+    int c;
+    while ((c = peek()) != END_OF_INPUT && c != ']' && c != '\n' && c != '[') {
+        get();
+    }
+    if (c == ']') {
+        get();
+    }
+
+    if (name == "FEN" && game.error.empty() && !Position::fromFen(value, game.start)) {
+        game.error = "invalid FEN \"" + value + "\"";
+    }
+    game.tags.emplace_back(std::move(name), std::move(value));
+}
+
+bool PdnReader::parseMoveToken(PdnGame& game, std::size_t start) {
+    std::size_t end = m_token.size();
+    // Annotations such as "!" or "?!" and a trailing "*" for a forced capture
+    while (end > start && CHAR_CLASSES.is(m_token[end - 1], ANNOTATION)) {
+        end--;
+    }
+    if (start == end) {
+        return true;
+    }
+
+    PdnMove move;
+    std::size_t position = start;
+    while (position < end) {
+        std::size_t squareEnd = position;
+        if (CHAR_CLASSES.is(m_token[squareEnd], LETTER)) {
+            squareEnd++;
+        }
+        while (squareEnd < end && CHAR_CLASSES.is(m_token[squareEnd], DIGIT)) {
+            squareEnd++;
+        }
+        int square = parseSquare(m_token.data() + position, squareEnd - position);
+        if (square < 0 || move.count == move.squares.size()) {
+            return false;
+        }
+        move.squares[move.count++] = static_cast<std::uint8_t>(square);
+
+        position = squareEnd;
+        if (position == end) {
+            break;
+        }
+        char separator = m_token[position++];
+        if (separator == 'x' || separator == ':') {
+            move.capture = true;
+        } else if (separator != '-') {
+            return false;
+        }
+    }
+    if (move.count < 2) {
+        return false;
+    }
+    game.moves.push_back(move);
+    return true;
+}
+
+bool PdnReader::next(PdnGame& game) {
+    game.clear();
+    bool found = false;
+    bool inMovetext = false;
+    bool resultSeen = false;
+
+    while (!resultSeen) {
+        skipSpace();
+        int c = peek();
+        if (c == END_OF_INPUT) {
+            break;
+        }
+        if (c == '[') {
+            // Tags after movetext start the next game
+            if (inMovetext) {
+                break;
+            }
+            readTag(game);
+            found = true;
+            continue;
+        }
+        if (c == '{') {
+            skipComment();
+            continue;
+        }
+        if (c == ';') {
+            skipLine();
+            continue;
+        }
+        if (c == '(') {
+            skipVariation();
+            continue;
+        }
+
+        readToken();
+        found = true;
+        inMovetext = true;
+        if (m_token.empty() || m_token[0] == '$') {
+            continue;
+        }
+        if (parseResult(m_token, game.result)) {
+            resultSeen = true;
+            continue;
+        }
+
+        // Move numbers: "12." or "12..." on their own or glued to the move
+        std::size_t start = 0;
+        while (start < m_token.size() && CHAR_CLASSES.is(m_token[start], DIGIT)) {
+            start++;
+        }
+        if (start < m_token.size() && m_token[start] == '.') {
+            while (start < m_token.size() && m_token[start] == '.') {
+                start++;
+            }
+        } else {
+            start = 0;
+        }
+        if (!parseMoveToken(game, start) && game.error.empty()) {
+            game.error = "unreadable move \"" + std::string(m_token) + "\"";
+        }
+    }
+    if (!found) {
+        return false;
+    }
+
+    if (!resultSeen) {
+        if (const std::string* tag = game.getTag("Result")) {
+            parseResult(*tag, game.result);
+        }
+    }
+    if (m_validate && game.error.empty()) {
+        validate(game);
+    }
+    m_gamesRead++;
+    return true;
+}
+
+void PdnReader::validate(PdnGame& game) {
+    Position position = game.start;
+    for (std::size_t i = 0; i < game.moves.size(); i++) {
+        const PdnMove& move = game.moves[i];
+        if (applyExact(position, move)) {
+            continue;
+        }
+        PathSearch search{move, PdnMove(), PdnMove(), Position()};
+        search.path.squares[0] = move.squares[0];
+        search.path.count = 1;
+        searchPath(position, search, 1);
+        if (search.solutions != 1) {
+            std::size_t number = (i + game.start.blackToMove) / 2 + 1;
+            bool white = position.getSideToMove() == PieceColor::White;
+            game.error = std::string(search.solutions == 0 ? "illegal" : "ambiguous") + " move " +
+                         std::to_string(number) + (white ? ". " : "... ") + moveText(move);
+            return;
+        }
+        // Shorthand captures are stored with their full path
+        game.moves[i] = search.found;
+        position = search.foundPosition;
+    }
+}
+
+PdnWriter::PdnWriter(std::ostream& output)
+    : m_output(output) {
+}
+
+void PdnWriter::write(const PdnGame& game) {
+    bool hasResult = false;
+    for (const auto& tag : game.tags) {
+        m_output << '[' << tag.first << " \"";
+        for (char c : tag.second) {
+            if (c == '"' || c == '\\') {
+                m_output << '\\';
+            }
+            m_output << c;
+        }
+        m_output << "\"]\n";
+        hasResult = hasResult || tag.first == "Result";
+    }
+    if (!hasResult) {
+        m_output << "[Result \"" << pdnResultText(game.result) << "\"]\n";
+    }
+    m_output << '\n';
+
+    m_line.clear();
+    auto append = [this](const std::string& token) {
+        if (!m_line.empty() && m_line.size() + 1 + token.size() > 79) {
+            m_output << m_line << '\n';
+            m_line.clear();
+        }
+        if (!m_line.empty()) {
+            m_line += ' ';
+        }
+        m_line += token;
+    };
+
+    int number = 1;
+    PieceColor side = game.start.getSideToMove();
+    for (std::size_t i = 0; i < game.moves.size(); i++) {
+        if (side == PieceColor::White) {
+            append(std::to_string(number) + ". " + moveText(game.moves[i]));
+        } else {
+            append(i == 0 ? std::to_string(number) + "... " + moveText(game.moves[i]) : moveText(game.moves[i]));
+            number++;
+        }
+        if (i < game.annotations.size()) {
+            // Word by word, so long comments wrap like the rest of the movetext
+            std::size_t start = 0;
+            const std::string& text = game.annotations[i];
+            while (start < text.size()) {
+                std::size_t end = std::min(text.find(' ', start), text.size());
+                if (end > start) {
+                    append(text.substr(start, end - start));
+                }
+                start = end + 1;
+            }
+        }
+        side = side == PieceColor::White ? PieceColor::Black : PieceColor::White;
+    }
+    append(pdnResultText(game.result));
+    m_output << m_line << "\n\n";
+    m_gamesWritten++;
+}
+
+const char* pdnResultText(PdnResult result) {
+    switch (result) {
+        case PdnResult::WhiteWins: return "2-0";
+        case PdnResult::BlackWins: return "0-2";
+        case PdnResult::Draw: return "1-1";
+        default: return "*";
+    }
+}
@@ -0,0 +1,132 @@
+#include "../include/PlayerController.hpp"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+RandomController::RandomController(unsigned int seed)
+    : m_rng(seed) {
+}
+
+bool RandomController::chooseMove(Board& board, PieceColor color, Board::Move& move) {
+    std::vector<Board::Move> moves = board.getLegalMoves(color);
+    if (moves.empty()) {
+        return false;
+    }
+    
+    std::uniform_int_distribution<std::size_t> pick(0, moves.size() - 1);
+    move = moves[pick(m_rng)];
+    return true;
+}
+
+ScriptController::ScriptController(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open move script: " + path);
+    }
+    
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        // Skip blank lines and comments
+        std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        
+        std::istringstream fields(line);
+        Board::Move move;
+        if (!(fields >> move.fromRow >> move.fromCol >> move.toRow >> move.toCol)) {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": expected 'fromRow fromCol toRow toCol'");
+        }
+        m_moves.push(move);
+    }
+}
+
+bool ScriptController::chooseMove(Board&, PieceColor, Board::Move& move) {
+    if (m_moves.empty()) {
+        return false;
+    }
+    
+    move = m_moves.front();
+    m_moves.pop();
+    return true;
+}
+
+EngineController::EngineController(const SearchLimits& limits, std::size_t hashMegabytes)
+    : m_engine(hashMegabytes),
+      m_limits(limits) {
+}
+
+EngineController::~EngineController() {
+    stopPondering();
+}
+
+bool EngineController::chooseMove(Board& board, PieceColor color, Board::Move& move) {
+    Position position = board.getPosition(color);
+    // The rest of a multi-capture was decided along with its first hop
+    if (m_nextHop >= m_turn.size() || position != m_turnPosition) {
+        SearchResult result = m_ponder.valid() ? searchAfterPondering(position) : m_engine.search(position, m_limits);
+        m_turn = std::move(result.turn);
+        m_reply = std::move(result.reply);
+        m_nextHop = 0;
+        m_turnPosition = position;
+        if (m_turn.empty()) {
+            return false;
+        }
+    }
+    
+    const Hop& hop = m_turn[m_nextHop++];
+    Board::BoardRules::applyHop(m_turnPosition, hop);
+    move = {squareRow(hop.from), squareCol(hop.from), squareRow(hop.to), squareCol(hop.to)};
+    return true;
+}
+
+void EngineController::startPondering(const Board& board, PieceColor opponent) {
+    stopPondering();
+    // Only a finished turn of ours with an expected reply gives something to search
+    Position position = board.getPosition(opponent);
+    if (!m_ponderEnabled || m_nextHop < m_turn.size() || position != m_turnPosition || m_reply.empty()) {
+        return;
+    }
+    for (const Hop& hop : m_reply) {
+        Board::BoardRules::applyHop(position, hop);
+    }
+    m_ponderPosition = position;
+    m_ponderStart = std::chrono::steady_clock::now();
+    
+    // No time limit: the opponent's clock decides how long this runs
+    SearchLimits limits = m_limits;
+    limits.milliseconds = 0;
+    m_ponder = std::async(std::launch::async, [this, position, limits]() { return m_engine.search(position, limits); });
+}
+
+void EngineController::stopPondering() {
+    if (!m_ponder.valid()) {
+        return;
+    }
+    m_engine.stop();
+    m_ponder.get();
+    m_engine.resume();
+}
+
+SearchResult EngineController::searchAfterPondering(const Position& position) {
+    if (position != m_ponderPosition) {
+        m_ponderMisses++;
+        stopPondering();
+        return m_engine.search(position, m_limits);
+    }
+    
+    // A hit: time spent while the opponent thought counts towards the move's budget
+    m_ponderHits++;
+    if (m_limits.milliseconds > 0) {
+        auto deadline = m_ponderStart + std::chrono::milliseconds(m_limits.milliseconds);
+        if (m_ponder.wait_until(deadline) != std::future_status::ready) {
+            m_engine.stop();
+        }
+    }
+    SearchResult result = m_ponder.get();
+    m_engine.resume();
+    return result;
+}
@@ -0,0 +1,184 @@
+#include "../include/Position.hpp"
+#include "../include/Engine.hpp"
+#include <array>
+#include <cctype>
+
+namespace {
+
+std::uint64_t splitMix64(std::uint64_t& state) {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Keys per square for white man, white king, black man and black king, in that order.
+// Game stores on disk depend on these values.
+struct ZobristKeys {
+    std::array<std::array<std::uint64_t, 4>, 32> squares{};
+    std::uint64_t blackToMove = 0;
+
+    ZobristKeys() {
+        std::uint64_t state = 0x436865636B657273ull;
+        for (auto& square : squares) {
+            for (auto& key : square) {
+                key = splitMix64(state);
+            }
+        }
+        blackToMove = splitMix64(state);
+    }
+};
+
+const ZobristKeys ZOBRIST;
+
+std::uint64_t hashPieces(std::uint32_t bits, int code) {
+    std::uint64_t hash = 0;
+    while (bits) {
+        hash ^= ZOBRIST.squares[lowestSquare(bits)][code];
+        bits &= bits - 1;
+    }
+    return hash;
+}
+
+} // namespace
+
+std::string squareName(int square) {
+    std::string name(2, ' ');
+    name[0] = static_cast<char>('a' + squareCol(square));
+    name[1] = static_cast<char>('0' + 8 - squareRow(square));
+    return name;
+}
+
+int parseSquare(const char* text, std::size_t length) {
+    if (length == 0 || length > 2) {
+        return -1;
+    }
+    // Plain comparisons rather than <cctype>: this runs for every square of a PDN archive
+    char letter = text[0] >= 'A' && text[0] <= 'Z' ? static_cast<char>(text[0] - 'A' + 'a') : text[0];
+    if (length == 2 && letter >= 'a' && letter <= 'z') {
+        int col = letter - 'a';
+        int row = 8 - (text[1] - '0');
+        if (col < 0 || col >= 8 || row < 0 || row >= 8 || (row + col) % 2 == 0) {
+            return -1;
+        }
+        return squareIndex(row, col);
+    }
+    int number = 0;
+    for (std::size_t i = 0; i < length; i++) {
+        if (text[i] < '0' || text[i] > '9') {
+            return -1;
+        }
+        number = number * 10 + (text[i] - '0');
+    }
+    return number >= 1 && number <= 32 ? number - 1 : -1;
+}
+
+Position Position::initial() {
+    return EngineRules::initial();
+}
+
+std::uint64_t Position::hash() const {
+    std::uint64_t hash = blackToMove ? ZOBRIST.blackToMove : 0;
+    hash ^= hashPieces(white & ~kings, 0);
+    hash ^= hashPieces(white & kings, 1);
+    hash ^= hashPieces(black & ~kings, 2);
+    hash ^= hashPieces(black & kings, 3);
+    return hash;
+}
+
+bool Position::fromFen(const std::string& text, Position& position) {
+    std::size_t begin = text.find_first_not_of(" \t\"");
+    if (begin == std::string::npos) {
+        return false;
+    }
+    std::size_t end = text.find_last_not_of(" \t\".");
+    std::string fen = text.substr(begin, end - begin + 1);
+
+    Position result;
+    std::size_t sectionStart = 0;
+    bool first = true;
+    while (sectionStart <= fen.size()) {
+        std::size_t sectionEnd = fen.find(':', sectionStart);
+        if (sectionEnd == std::string::npos) {
+            sectionEnd = fen.size();
+        }
+        std::string section = fen.substr(sectionStart, sectionEnd - sectionStart);
+        sectionStart = sectionEnd + 1;
+        if (section.empty()) {
+            continue;
+        }
+        char color = static_cast<char>(std::toupper(static_cast<unsigned char>(section[0])));
+        if (first) {
+            if (section.size() != 1 || (color != 'W' && color != 'B')) {
+                return false;
+            }
+            result.setSideToMove(color == 'W' ? PieceColor::White : PieceColor::Black);
+            first = false;
+            continue;
+        }
+        // Other sections (move numbers and the like) are ignored
+        if (color != 'W' && color != 'B') {
+            continue;
+        }
+
+        std::uint32_t& pieces = color == 'W' ? result.white : result.black;
+        std::size_t itemStart = 1;
+        while (itemStart < section.size()) {
+            std::size_t itemEnd = section.find(',', itemStart);
+            if (itemEnd == std::string::npos) {
+                itemEnd = section.size();
+            }
+            std::string item = section.substr(itemStart, itemEnd - itemStart);
+            itemStart = itemEnd + 1;
+            if (item.empty()) {
+                continue;
+            }
+
+            bool king = item[0] == 'K' || item[0] == 'k';
+            if (king) {
+                item.erase(0, 1);
+            }
+            std::size_t dash = item.find('-');
+            int from = parseSquare(item.data(), dash == std::string::npos ? item.size() : dash);
+            int to = dash == std::string::npos ? from : parseSquare(item.data() + dash + 1, item.size() - dash - 1);
+            if (from < 0 || to < from) {
+                return false;
+            }
+            for (int square = from; square <= to; square++) {
+                std::uint32_t bit = std::uint32_t(1) << square;
+                result.white &= ~bit;
+                result.black &= ~bit;
+                result.kings &= ~bit;
+                pieces |= bit;
+                if (king) {
+                    result.kings |= bit;
+                }
+            }
+        }
+    }
+    if (first) {
+        return false;
+    }
+    position = result;
+    return true;
+}
+
+std::string Position::toFen() const {
+    std::string fen = blackToMove ? "B" : "W";
+    for (PieceColor color : {PieceColor::White, PieceColor::Black}) {
+        fen += color == PieceColor::White ? ":W" : ":B";
+        bool firstSquare = true;
+        for (std::uint32_t bits = getPieces(color); bits; bits &= bits - 1) {
+            int square = lowestSquare(bits);
+            if (!firstSquare) {
+                fen += ',';
+            }
+            if (kings & (std::uint32_t(1) << square)) {
+                fen += 'K';
+            }
+            fen += squareName(square);
+            firstSquare = false;
+        }
+    }
+    return fen;
+}
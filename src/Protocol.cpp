@@ -0,0 +1,129 @@
+#include "../include/Protocol.hpp"
+
+namespace {
+
+std::uint8_t colorCode(PieceColor color) {
+    return color == PieceColor::White ? 0 : 1;
+}
+
+PieceColor colorFromCode(std::uint8_t code) {
+    return code == 0 ? PieceColor::White : PieceColor::Black;
+}
+
+void writeTimeControl(sf::Packet& packet, const TimeControl& timeControl) {
+    packet << static_cast<std::uint8_t>(timeControl.type) << timeControl.initialMicros << timeControl.incrementMicros;
+}
+
+void readTimeControl(sf::Packet& packet, TimeControl& timeControl) {
+    std::uint8_t type = 0;
+    packet >> type >> timeControl.initialMicros >> timeControl.incrementMicros;
+    timeControl.type = static_cast<TimeControlType>(type);
+}
+
+void writePosition(sf::Packet& packet, const Position& position) {
+    packet << position.white << position.black << position.kings << position.blackToMove << position.chainSquare;
+}
+
+void readPosition(sf::Packet& packet, Position& position) {
+    packet >> position.white >> position.black >> position.kings >> position.blackToMove >> position.chainSquare;
+}
+
+} // namespace
+
+sf::Packet& operator<<(sf::Packet& packet, const HelloMessage& message) {
+    return packet << message.sessionToken << message.lastEventSeq << message.spectate << message.roomId;
+}
+
+sf::Packet& operator>>(sf::Packet& packet, HelloMessage& message) {
+    return packet >> message.sessionToken >> message.lastEventSeq >> message.spectate >> message.roomId;
+}
+
+sf::Packet& operator<<(sf::Packet& packet, const GameStartMessage& message) {
+    packet << colorCode(message.color);
+    writeTimeControl(packet, message.timeControl);
+    return packet << message.sessionToken << message.roomId;
+}
+
+sf::Packet& operator>>(sf::Packet& packet, GameStartMessage& message) {
+    std::uint8_t color = 0;
+    packet >> color;
+    readTimeControl(packet, message.timeControl);
+    packet >> message.sessionToken >> message.roomId;
+    message.color = colorFromCode(color);
+    return packet;
+}
+
+sf::Packet& operator<<(sf::Packet& packet, const ClockMessage& message) {
+    return packet << message.whiteMicros << message.blackMicros << colorCode(message.sideToMove);
+}
+
+sf::Packet& operator>>(sf::Packet& packet, ClockMessage& message) {
+    std::uint8_t side = 0;
+    packet >> message.whiteMicros >> message.blackMicros >> side;
+    message.sideToMove = colorFromCode(side);
+    return packet;
+}
+
+sf::Packet& operator<<(sf::Packet& packet, const GameOverMessage& message) {
+    return packet << message.draw << colorCode(message.winner) << static_cast<std::uint8_t>(message.reason);
+}
+
+sf::Packet& operator>>(sf::Packet& packet, GameOverMessage& message) {
+    std::uint8_t winner = 0, reason = 0;
+    packet >> message.draw >> winner >> reason;
+    message.winner = colorFromCode(winner);
+    message.reason = static_cast<GameOverReason>(reason);
+    return packet;
+}
+
+sf::Packet& operator<<(sf::Packet& packet, const ResyncMessage& message) {
+    packet << colorCode(message.color);
+    writeTimeControl(packet, message.timeControl);
+    packet << message.sessionToken << message.baseSeq;
+    writePosition(packet, message.position);
+    packet << message.moveCount;
+    
+    packet << static_cast<std::uint16_t>(message.moves.size());
+    for (const Board::Move& move : message.moves) {
+        packet << static_cast<std::uint8_t>(move.fromRow) << static_cast<std::uint8_t>(move.fromCol)
+               << static_cast<std::uint8_t>(move.toRow) << static_cast<std::uint8_t>(move.toCol);
+    }
+    return packet;
+}
+
+sf::Packet& operator>>(sf::Packet& packet, ResyncMessage& message) {
+    std::uint8_t color = 0;
+    packet >> color;
+    readTimeControl(packet, message.timeControl);
+    packet >> message.sessionToken >> message.baseSeq;
+    message.color = colorFromCode(color);
+    
+    readPosition(packet, message.position);
+    packet >> message.moveCount;
+    
+    std::uint16_t count = 0;
+    packet >> count;
+    message.moves.clear();
+    for (std::uint16_t i = 0; i < count && packet; i++) {
+        std::uint8_t fromRow = 0, fromCol = 0, toRow = 0, toCol = 0;
+        packet >> fromRow >> fromCol >> toRow >> toCol;
+        message.moves.push_back({fromRow, fromCol, toRow, toCol});
+    }
+    return packet;
+}
+
+sf::Packet& operator<<(sf::Packet& packet, const SpectateMessage& message) {
+    packet << message.roomId;
+    writeTimeControl(packet, message.timeControl);
+    packet << message.eventSeq;
+    writePosition(packet, message.position);
+    return packet << message.moveCount;
+}
+
+sf::Packet& operator>>(sf::Packet& packet, SpectateMessage& message) {
+    packet >> message.roomId;
+    readTimeControl(packet, message.timeControl);
+    packet >> message.eventSeq;
+    readPosition(packet, message.position);
+    return packet >> message.moveCount;
+}
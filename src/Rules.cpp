@@ -0,0 +1,7 @@
+#include "../include/Rules.hpp"
+
+// Every variant is instantiated with the library, so the ones the game does not play
+// yet are still compiled and checked
+template struct Rules<variants::Russian>;
+template struct Rules<variants::English>;
+template struct Rules<variants::International>;
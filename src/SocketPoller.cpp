@@ -0,0 +1,89 @@
+#include "../include/SocketPoller.hpp"
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <poll.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+using PollDescriptor = WSAPOLLFD;
+
+int pollDescriptors(PollDescriptor* descriptors, std::size_t count, int timeoutMs) {
+    return WSAPoll(descriptors, static_cast<ULONG>(count), timeoutMs);
+}
+#else
+using PollDescriptor = pollfd;
+
+int pollDescriptors(PollDescriptor* descriptors, std::size_t count, int timeoutMs) {
+    return poll(descriptors, static_cast<nfds_t>(count), timeoutMs);
+}
+#endif
+
+} // namespace
+
+struct SocketPoller::Descriptors {
+    // Parallel arrays; removing a socket moves the last one into its slot
+    std::vector<PollDescriptor> descriptors;
+    std::vector<std::uint32_t> ids;
+    std::unordered_map<std::uint32_t, std::size_t> slots;   // id -> index
+};
+
+SocketPoller::SocketPoller()
+    : m_descriptors(std::make_unique<Descriptors>()) {
+}
+
+SocketPoller::~SocketPoller() = default;
+
+void SocketPoller::add(const sf::Socket& socket, std::uint32_t id) {
+    PollDescriptor descriptor{};
+    descriptor.fd = socket.getNativeHandle();
+    descriptor.events = POLLIN;
+    m_descriptors->slots[id] = m_descriptors->descriptors.size();
+    m_descriptors->descriptors.push_back(descriptor);
+    m_descriptors->ids.push_back(id);
+}
+
+void SocketPoller::remove(std::uint32_t id) {
+    auto slot = m_descriptors->slots.find(id);
+    if (slot == m_descriptors->slots.end()) {
+        return;
+    }
+    std::size_t index = slot->second;
+    std::size_t last = m_descriptors->descriptors.size() - 1;
+    if (index != last) {
+        m_descriptors->descriptors[index] = m_descriptors->descriptors[last];
+        m_descriptors->ids[index] = m_descriptors->ids[last];
+        m_descriptors->slots[m_descriptors->ids[index]] = index;
+    }
+    m_descriptors->descriptors.pop_back();
+    m_descriptors->ids.pop_back();
+    m_descriptors->slots.erase(slot);
+}
+
+void SocketPoller::clear() {
+    m_descriptors->descriptors.clear();
+    m_descriptors->ids.clear();
+    m_descriptors->slots.clear();
+    m_ready.clear();
+}
+
+bool SocketPoller::wait(std::int64_t timeoutMicros) {
+    m_ready.clear();
+    // poll() counts in milliseconds; round up so a short wait does not become a busy loop
+    int timeoutMs = static_cast<int>((timeoutMicros + 999) / 1000);
+    std::vector<PollDescriptor>& descriptors = m_descriptors->descriptors;
+    if (pollDescriptors(descriptors.data(), descriptors.size(), timeoutMs) <= 0) {
+        return false;
+    }
+    // Hang-ups and errors count as ready: reading is how the owner finds out
+    for (std::size_t i = 0; i < descriptors.size(); i++) {
+        if (descriptors[i].revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL)) {
+            m_ready.push_back(m_descriptors->ids[i]);
+        }
+    }
+    return !m_ready.empty();
+}
@@ -0,0 +1,129 @@
+#include "../include/TimerWheel.hpp"
+
+TimerWheel::TimerWheel(std::int64_t startMicros, std::int64_t tickMicros)
+    : m_startMicros(startMicros), m_tickMicros(tickMicros) {
+    m_slots.fill(NIL);
+}
+
+TimerWheel::TimerId TimerWheel::schedule(std::int64_t deadlineMicros, std::uint64_t payload) {
+    std::uint32_t index;
+    if (!m_freeNodes.empty()) {
+        index = m_freeNodes.back();
+        m_freeNodes.pop_back();
+    } else {
+        index = static_cast<std::uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+
+    Node& node = m_nodes[index];
+    // Round up, so a timer never fires before its deadline
+    node.expiryTick = tickFor(deadlineMicros + m_tickMicros - 1);
+    node.payload = payload;
+    // The current tick has already been processed
+    link(index, m_currentTick + 1);
+    m_count++;
+    return (static_cast<TimerId>(node.generation) << 32) | index;
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    std::uint32_t index = static_cast<std::uint32_t>(id & 0xFFFFFFFF);
+    std::uint32_t generation = static_cast<std::uint32_t>(id >> 32);
+    if (index >= m_nodes.size() || m_nodes[index].generation != generation || m_nodes[index].state == NodeState::Free) {
+        return false;
+    }
+
+    if (m_nodes[index].state == NodeState::Linked) {
+        unlink(index);
+    }
+    release(index);
+    return true;
+}
+
+std::int64_t TimerWheel::microsUntilNextCheck(std::int64_t nowMicros) const {
+    if (m_count == 0) {
+        return 1000000;
+    }
+
+    // The next non-empty slot of the finest wheel, or the next cascade, whichever is first
+    std::uint64_t tick = m_currentTick + 1;
+    for (; (tick & (SLOTS - 1)) != 0; tick++) {
+        if (m_slots[tick & (SLOTS - 1)] != NIL) {
+            break;
+        }
+    }
+    std::int64_t due = m_startMicros + static_cast<std::int64_t>(tick) * m_tickMicros;
+    return std::max<std::int64_t>(due - nowMicros, 0);
+}
+
+std::uint64_t TimerWheel::tickFor(std::int64_t micros) const {
+    if (micros <= m_startMicros) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>((micros - m_startMicros) / m_tickMicros);
+}
+
+void TimerWheel::link(std::uint32_t index, std::uint64_t earliestTick) {
+    Node& node = m_nodes[index];
+    if (node.expiryTick < earliestTick) {
+        node.expiryTick = earliestTick;
+    }
+
+    std::uint64_t delta = node.expiryTick - m_currentTick;
+    std::uint64_t placement = node.expiryTick;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (std::uint64_t(1) << ((level + 1) * SLOT_BITS))) {
+        level++;
+    }
+    // Beyond the outermost wheel: park in its furthest slot and re-place on cascade
+    std::uint64_t span = std::uint64_t(1) << (LEVELS * SLOT_BITS);
+    if (delta >= span) {
+        placement = m_currentTick + span - 1;
+    }
+
+    std::uint32_t slot = static_cast<std::uint32_t>(level * SLOTS + ((placement >> (level * SLOT_BITS)) & (SLOTS - 1)));
+    node.slot = static_cast<std::uint16_t>(slot);
+    node.prev = NIL;
+    node.next = m_slots[slot];
+    if (node.next != NIL) {
+        m_nodes[node.next].prev = index;
+    }
+    m_slots[slot] = index;
+    node.state = NodeState::Linked;
+}
+
+void TimerWheel::unlink(std::uint32_t index) {
+    Node& node = m_nodes[index];
+    if (node.prev != NIL) {
+        m_nodes[node.prev].next = node.next;
+    } else {
+        m_slots[node.slot] = node.next;
+    }
+    if (node.next != NIL) {
+        m_nodes[node.next].prev = node.prev;
+    }
+    node.prev = NIL;
+    node.next = NIL;
+}
+
+void TimerWheel::release(std::uint32_t index) {
+    Node& node = m_nodes[index];
+    node.state = NodeState::Free;
+    node.generation++;
+    if (node.generation == 0) {
+        node.generation = 1;
+    }
+    m_freeNodes.push_back(index);
+    m_count--;
+}
+
+void TimerWheel::cascade(int level) {
+    std::uint32_t slot = static_cast<std::uint32_t>(level * SLOTS + ((m_currentTick >> (level * SLOT_BITS)) & (SLOTS - 1)));
+    std::uint32_t index = m_slots[slot];
+    m_slots[slot] = NIL;
+    while (index != NIL) {
+        std::uint32_t next = m_nodes[index].next;
+        // Cascades run before the current tick's slot fires
+        link(index, m_currentTick);
+        index = next;
+    }
+}
@@ -0,0 +1,256 @@
+#include "../include/Tuner.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include "../include/Engine.hpp"
+#include "../include/Pdn.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TUNER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Positions handled per pass, small enough for the block's evaluations to stay in cache
+constexpr std::size_t BLOCK = 2048;
+
+// values += factor * column
+void addScaled(float* values, const float* column, float factor, std::size_t count) {
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 scale = _mm256_set1_ps(factor);
+    for (; i + 8 <= count; i += 8) {
+        __m256 sum = _mm256_add_ps(_mm256_loadu_ps(values + i), _mm256_mul_ps(_mm256_loadu_ps(column + i), scale));
+        _mm256_storeu_ps(values + i, sum);
+    }
+#elif defined(TUNER_SSE2)
+    const __m128 scale = _mm_set1_ps(factor);
+    for (; i + 4 <= count; i += 4) {
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(values + i), _mm_mul_ps(_mm_loadu_ps(column + i), scale));
+        _mm_storeu_ps(values + i, sum);
+    }
+#endif
+    for (; i < count; i++) {
+        values[i] += factor * column[i];
+    }
+}
+
+double dot(const float* a, const float* b, std::size_t count) {
+    std::size_t i = 0;
+    float sum = 0;
+#if defined(__AVX2__)
+    __m256 sums = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        sums = _mm256_add_ps(sums, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sums), _mm256_extractf128_ps(sums, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 0x55));
+    sum = _mm_cvtss_f32(half);
+#elif defined(TUNER_SSE2)
+    __m128 sums = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        sums = _mm_add_ps(sums, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    sums = _mm_add_ps(sums, _mm_movehl_ps(sums, sums));
+    sums = _mm_add_ss(sums, _mm_shuffle_ps(sums, sums, 0x55));
+    sum = _mm_cvtss_f32(sums);
+#endif
+    for (; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// Per 400 points of evaluation the expected score moves by a factor of ten in odds
+double logisticRate(double scale) {
+    return scale * std::log(10.0) / 400.0;
+}
+
+} // namespace
+
+void TuningSet::clear() {
+    for (auto& column : terms) {
+        column.clear();
+    }
+    results.clear();
+}
+
+Tuner::Tuner(unsigned int threads)
+    : m_threads(std::max(1u, threads)) {
+}
+
+Tuner::Weights Tuner::toWeights(const EvalWeights& weights) {
+    Weights values{};
+    std::array<int, EvalWeights::TERMS> integers = weights.toArray();
+    std::copy(integers.begin(), integers.end(), values.begin());
+    return values;
+}
+
+EvalWeights Tuner::fromWeights(const Weights& weights) {
+    std::array<int, EvalWeights::TERMS> integers{};
+    for (int term = 0; term < EvalWeights::TERMS; term++) {
+        integers[term] = static_cast<int>(std::lround(weights[term]));
+    }
+    return EvalWeights::fromArray(integers);
+}
+
+bool Tuner::load(std::istream& pdn, int skipTurns) {
+    if (!pdn) {
+        std::cerr << "Cannot read the game archive" << std::endl;
+        return false;
+    }
+    // Validation expands shorthand captures, so every move is a full path of hops
+    PdnReader reader(pdn);
+    PdnGame game;
+    while (reader.next(game)) {
+        if (!game.error.empty() || game.result == PdnResult::Unknown) {
+            m_skippedGames++;
+            continue;
+        }
+        float result = game.result == PdnResult::WhiteWins ? 1.0f : game.result == PdnResult::BlackWins ? 0.0f : 0.5f;
+        Position position = game.start;
+        bool legal = true;
+        for (std::size_t turn = 0; turn < game.moves.size() && legal; turn++) {
+            if (static_cast<int>(turn) >= skipTurns && !EngineRules::hasCapture(position, position.getSideToMove())) {
+                EvalTerms terms = Evaluator::countTerms(position);
+                for (int term = 0; term < EvalWeights::TERMS; term++) {
+                    m_positions.terms[term].push_back(static_cast<float>(terms[term]));
+                }
+                m_positions.results.push_back(result);
+            }
+            const PdnMove& move = game.moves[turn];
+            for (int i = 1; i < move.count && legal; i++) {
+                Hop hop;
+                legal = EngineRules::findHop(position, move.squares[i - 1], move.squares[i], hop);
+                if (legal) {
+                    EngineRules::applyHop(position, hop);
+                }
+            }
+        }
+        m_games++;
+    }
+    return true;
+}
+
+double Tuner::evaluate(const Weights& weights, double scale, Weights* gradient) const {
+    const std::size_t count = m_positions.size();
+    if (count == 0) {
+        return 0;
+    }
+    const double rate = logisticRate(scale);
+    unsigned int threads = static_cast<unsigned int>(std::min<std::size_t>(m_threads, (count + BLOCK - 1) / BLOCK));
+    std::vector<double> losses(threads, 0);
+    std::vector<Weights> gradients(threads, Weights{});
+
+    auto work = [&](unsigned int thread) {
+        std::size_t begin = count * thread / threads;
+        std::size_t end = count * (thread + 1) / threads;
+        std::vector<float> evals(BLOCK);
+        std::vector<float> slopes(BLOCK);
+        for (std::size_t start = begin; start < end; start += BLOCK) {
+            std::size_t size = std::min(BLOCK, end - start);
+            std::fill(evals.begin(), evals.begin() + size, 0.0f);
+            for (int term = 0; term < EvalWeights::TERMS; term++) {
+                addScaled(evals.data(), m_positions.terms[term].data() + start, static_cast<float>(weights[term]), size);
+            }
+            const float* results = m_positions.results.data() + start;
+            double loss = 0;
+            for (std::size_t i = 0; i < size; i++) {
+                double expected = 1.0 / (1.0 + std::exp(-rate * evals[i]));
+                double error = expected - results[i];
+                loss += error * error;
+                slopes[i] = static_cast<float>(error * expected * (1.0 - expected));
+            }
+            losses[thread] += loss;
+            if (gradient) {
+                for (int term = 0; term < EvalWeights::TERMS; term++) {
+                    gradients[thread][term] += dot(slopes.data(), m_positions.terms[term].data() + start, size);
+                }
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned int thread = 1; thread < threads; thread++) {
+        workers.emplace_back(work, thread);
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double loss = 0;
+    for (unsigned int thread = 0; thread < threads; thread++) {
+        loss += losses[thread];
+    }
+    if (gradient) {
+        gradient->fill(0);
+        for (unsigned int thread = 0; thread < threads; thread++) {
+            for (int term = 0; term < EvalWeights::TERMS; term++) {
+                (*gradient)[term] += 2.0 * rate * gradients[thread][term] / count;
+            }
+        }
+    }
+    return loss / count;
+}
+
+double Tuner::loss(const Weights& weights, double scale) const {
+    return evaluate(weights, scale, nullptr);
+}
+
+double Tuner::fitScale(const Weights& weights) const {
+    // The loss has a single minimum in the scale; narrow in on it by golden sections
+    const double ratio = (std::sqrt(5.0) - 1) / 2;
+    double low = 0.05;
+    double high = 10.0;
+    double a = high - ratio * (high - low);
+    double b = low + ratio * (high - low);
+    double lossA = loss(weights, a);
+    double lossB = loss(weights, b);
+    while (high - low > 1e-4) {
+        if (lossA < lossB) {
+            high = b;
+            b = a;
+            lossB = lossA;
+            a = high - ratio * (high - low);
+            lossA = loss(weights, a);
+        } else {
+            low = a;
+            a = b;
+            lossA = lossB;
+            b = low + ratio * (high - low);
+            lossB = loss(weights, b);
+        }
+    }
+    return (low + high) / 2;
+}
+
+Tuner::Weights Tuner::tune(const Weights& start, double scale, int iterations, double rate,
+                           const Progress& progress) const {
+    const double beta1 = 0.9;
+    const double beta2 = 0.999;
+    const double epsilon = 1e-12;
+    Weights weights = start;
+    Weights momentum{};
+    Weights velocity{};
+    Weights gradient{};
+    for (int iteration = 1; iteration <= iterations; iteration++) {
+        double current = evaluate(weights, scale, &gradient);
+        double correction1 = 1 - std::pow(beta1, iteration);
+        double correction2 = 1 - std::pow(beta2, iteration);
+        // Term 0 is the man, which defines the scale of everything else
+        for (int term = 1; term < EvalWeights::TERMS; term++) {
+            momentum[term] = beta1 * momentum[term] + (1 - beta1) * gradient[term];
+            velocity[term] = beta2 * velocity[term] + (1 - beta2) * gradient[term] * gradient[term];
+            weights[term] -= rate * (momentum[term] / correction1) / (std::sqrt(velocity[term] / correction2) + epsilon);
+        }
+        if (progress) {
+            progress(iteration, current, weights);
+        }
+    }
+    return weights;
+}
@@ -1,8 +1,134 @@
 #include <iostream>
+#include <memory>
+#include <random>
+#include <string>
 #include "../include/Game.hpp"
 
-int main() {
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: CheckersGame [--headless [options]]\n"
+              << "Headless options:\n"
+              << "  --host               host a network game and wait for an opponent\n"
+              << "  --join <ip>          join a network game\n"
+              << "  --watch <ip>         watch a game on a server\n"
+              << "  --room <n>           room to watch (default: the newest game)\n"
+              << "  --port <n>           network port (default 50001)\n"
+              << "  --script <file>      play moves from a script instead of a random bot\n"
+              << "  --engine             play the search engine's moves instead of a random bot\n"
+              << "  --depth <n>          engine search depth in moves (default 8)\n"
+              << "  --move-ms <n>        engine thinking time per move (default: no limit)\n"
+              << "  --no-ponder          do not let the engine think on the opponent's time\n"
+              << "  --seed <n>           random bot seed\n"
+              << "  --think-ms <n>       delay before each move\n"
+              << "  --max-moves <n>      declare a draw after this many moves (default 500)\n"
+              << "  --metrics            print network metrics when the game ends\n";
+}
+
+// Runs a game without a window; moves come from a random bot, the engine or a script
+int runHeadless(int argc, char* argv[]) {
+    bool host = false;
+    std::string joinIp;
+    std::string watchIp;
+    std::uint32_t roomId = 0;
+    unsigned short port = 50001;
+    std::string scriptPath;
+    bool useEngine = false;
+    SearchLimits limits;
+    limits.depth = 8;
+    bool ponder = true;
+    unsigned int seed = std::random_device{}();
+    int thinkTimeMs = 0;
+    int maxMoves = 500;
+    bool printMetrics = false;
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless") {
+            continue;
+        } else if (arg == "--host") {
+            host = true;
+        } else if (arg == "--join" && hasValue) {
+            joinIp = argv[++i];
+        } else if (arg == "--watch" && hasValue) {
+            watchIp = argv[++i];
+        } else if (arg == "--room" && hasValue) {
+            roomId = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--port" && hasValue) {
+            port = static_cast<unsigned short>(std::stoi(argv[++i]));
+        } else if (arg == "--script" && hasValue) {
+            scriptPath = argv[++i];
+        } else if (arg == "--engine") {
+            useEngine = true;
+        } else if (arg == "--depth" && hasValue) {
+            limits.depth = std::stoi(argv[++i]);
+        } else if (arg == "--move-ms" && hasValue) {
+            limits.milliseconds = std::stoi(argv[++i]);
+        } else if (arg == "--no-ponder") {
+            ponder = false;
+        } else if (arg == "--seed" && hasValue) {
+            seed = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--think-ms" && hasValue) {
+            thinkTimeMs = std::stoi(argv[++i]);
+        } else if (arg == "--max-moves" && hasValue) {
+            maxMoves = std::stoi(argv[++i]);
+        } else if (arg == "--metrics") {
+            printMetrics = true;
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    
+    std::unique_ptr<PlayerController> controller;
+    EngineController* engine = nullptr;
+    if (!scriptPath.empty()) {
+        controller = std::make_unique<ScriptController>(scriptPath);
+    } else if (useEngine) {
+        auto engineController = std::make_unique<EngineController>(limits);
+        engineController->setPondering(ponder);
+        engine = engineController.get();
+        controller = std::move(engineController);
+    } else {
+        controller = std::make_unique<RandomController>(seed);
+    }
+    
+    Game game(std::move(controller));
+    game.setThinkTime(thinkTimeMs);
+    game.setMoveLimit(maxMoves);
+    
+    if (host) {
+        game.hostGame(port);
+    } else if (!joinIp.empty()) {
+        game.joinGame(joinIp, port);
+    } else if (!watchIp.empty()) {
+        game.watchGame(watchIp, port, roomId);
+    } else {
+        game.startLocalGame();
+    }
+    game.run();
+    
+    std::cout << "Result: " << game.getResultText() << " after " << game.getMoveCount() << " moves" << std::endl;
+    if (engine && ponder) {
+        std::cout << "Ponder hits: " << engine->getPonderHits() << ", misses: " << engine->getPonderMisses() << std::endl;
+    }
+    if (printMetrics) {
+        std::cout << game.getNetworkMetrics();
+    }
+    return game.isFinished() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
     try {
+        for (int i = 1; i < argc; i++) {
+            if (std::string(argv[i]) == "--headless") {
+                return runHeadless(argc, argv);
+            }
+        }
+        
         // Create a game with a 800x800 window
         Game game(800, 800);
         game.run();
@@ -12,4 +138,4 @@ int main() {
     }
     
     return EXIT_SUCCESS;
-} 
\ No newline at end of file
+} 
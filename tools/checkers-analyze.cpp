@@ -0,0 +1,159 @@
+// Game analysis: searches every position of a PDN archive or game store on all cores and
+// writes the games back with engine scores and blunders marked
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "../include/Analyzer.hpp"
+#include "../include/GameStore.hpp"
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: checkers-analyze <in.pdn|store.db> <out.pdn> [options]\n"
+              << "  --depth <n>        search depth per position (default 8)\n"
+              << "  --ms <n>           time per position instead\n"
+              << "  --nodes <n>        nodes per position instead\n"
+              << "  --hash <MB>        hash table per thread (default 16)\n"
+              << "  --threads <n>      (default: all cores)\n"
+              << "  --blunder <n>      loss that marks a move, in hundredths of a man (default 100)\n"
+              << "  --max-games <n>    analyze only the first games\n"
+              << "\n"
+              << "A file ending in .db is read as a checkers-db store, anything else as PDN; use -\n"
+              << "for standard input or output. After every move the score (from White's side, in\n"
+              << "men) is written as a comment; blunders get a $4 and the engine's move.\n";
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool readPdn(const std::string& path, std::size_t maxGames, std::vector<PdnGame>& games) {
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Cannot open " << path << std::endl;
+            return false;
+        }
+    }
+    PdnReader reader(path == "-" ? std::cin : file);
+    PdnGame game;
+    while (games.size() < maxGames && reader.next(game)) {
+        if (!game.error.empty()) {
+            std::cerr << "game " << reader.getGamesRead() << ": " << game.error << std::endl;
+        }
+        games.push_back(game);
+    }
+    return true;
+}
+
+bool readStore(const std::string& path, std::size_t maxGames, std::vector<PdnGame>& games) {
+    GameStore store;
+    if (!store.open(path)) {
+        return false;
+    }
+    for (std::uint64_t id = 0; id < store.getGameCount() && games.size() < maxGames; id++) {
+        PdnGame game;
+        if (!store.getGame(static_cast<std::uint32_t>(id), game)) {
+            std::cerr << "Cannot decode game " << id << std::endl;
+            return false;
+        }
+        game.setTag("Event", "Game " + std::to_string(id));
+        game.setTag("GameType", "25");
+        games.push_back(std::move(game));
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    std::string inputPath = argv[1];
+    std::string outputPath = argv[2];
+
+    AnalysisOptions options;
+    options.limits.depth = 8;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t maxGames = SIZE_MAX;
+    try {
+        for (int i = 3; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--depth" && i + 1 < argc) {
+                options.limits.depth = std::stoi(argv[++i]);
+            } else if (arg == "--ms" && i + 1 < argc) {
+                options.limits.milliseconds = std::stoi(argv[++i]);
+                options.limits.depth = SearchLimits().depth;
+            } else if (arg == "--nodes" && i + 1 < argc) {
+                options.limits.nodes = std::stoull(argv[++i]);
+                options.limits.depth = SearchLimits().depth;
+            } else if (arg == "--hash" && i + 1 < argc) {
+                options.hashMegabytes = static_cast<std::size_t>(std::stoul(argv[++i]));
+            } else if (arg == "--threads" && i + 1 < argc) {
+                options.threads = static_cast<unsigned int>(std::stoi(argv[++i]));
+            } else if (arg == "--blunder" && i + 1 < argc) {
+                options.blunder = std::stoi(argv[++i]);
+            } else if (arg == "--max-games" && i + 1 < argc) {
+                maxGames = static_cast<std::size_t>(std::stoul(argv[++i]));
+            } else {
+                printUsage();
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception&) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<PdnGame> games;
+    bool read = endsWith(inputPath, ".db") ? readStore(inputPath, maxGames, games)
+                                           : readPdn(inputPath, maxGames, games);
+    if (!read) {
+        return EXIT_FAILURE;
+    }
+    std::ofstream outputFile;
+    if (outputPath != "-") {
+        outputFile.open(outputPath, std::ios::binary);
+        if (!outputFile) {
+            std::cerr << "Cannot create " << outputPath << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream& output = outputPath == "-" ? std::cout : outputFile;
+
+    auto start = std::chrono::steady_clock::now();
+    GameAnalyzer analyzer(options);
+    std::vector<std::vector<MoveAnalysis>> analyses = analyzer.analyze(games);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    PdnWriter writer(output);
+    std::uint64_t blunders = 0;
+    for (std::size_t g = 0; g < games.size(); g++) {
+        // Games that do not replay are left out, as checkers-pdn convert does
+        if (!games[g].error.empty() || analyses[g].size() != games[g].moves.size()) {
+            continue;
+        }
+        for (const MoveAnalysis& move : analyses[g]) {
+            blunders += move.blunder ? 1 : 0;
+        }
+        GameAnalyzer::annotate(games[g], analyses[g]);
+        writer.write(games[g]);
+    }
+    output.flush();
+
+    std::uint64_t positions = analyzer.getPositions();
+    std::cerr << writer.getGamesWritten() << " games analyzed, " << analyzer.getSkippedGames() << " skipped, "
+              << blunders << " blunders\n"
+              << positions << " positions in " << seconds << " s on " << options.threads << " threads ("
+              << (seconds > 0 ? positions / seconds : 0) << " positions/s, "
+              << (seconds > 0 ? analyzer.getNodes() / seconds : 0) << " nodes/s, "
+              << analyzer.getSteals() << " runs stolen)" << std::endl;
+    return EXIT_SUCCESS;
+}
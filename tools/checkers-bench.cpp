@@ -0,0 +1,159 @@
+// Search benchmark: searches a fixed set of positions to a fixed depth and reports the
+// node count, which only changes when the search itself does, and the speed
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include "../include/Engine.hpp"
+
+namespace {
+
+// Openings, middlegames and endings from engine games
+const char* const POSITIONS[] = {
+    "W:Wa1,c1,e1,g1,b2,d2,f2,h2,a3,c3,e3,g3:Bb8,d8,f8,h8,a7,c7,e7,g7,b6,d6,f6,h6",
+    "B:Wd4,f4,e3,g3,h2,a1,c1,e1,g1:Bb8,d8,f8,h8,e7,g7,d6,h6,a5,g5",
+    "B:Wf4,h4,c3,e3,a1,c1,g1:Bd8,f8,h8,b6,d6,f6,h6,g5",
+    "B:Wf4,e3,b2,h2,c1,e1,g1:Bb8,d8,f8,h8,a7,d6,f6,a5,b4",
+    "B:Wa5,h4,a3,c3,e3,a1:Bb8,f8,h8,c7,f6,c5",
+    "B:Wd4,f4,h4,a3,e3,b2,h2,c1,e1,g1:Bb8,d8,f8,h8,b6,d6,f6,h6,c5,g5",
+    "B:Wf4,h4,a3,c3,e3,g3,e1,g1:Bd8,e7,g7,b6,d6,f6,h6,g5",
+    "B:Wa5,f4,a3,c3,e3,d2,f2,a1,e1,g1:Bb8,f8,h8,c7,b6,d6,f6,h6,c5,g5",
+    "B:Wc3,e3,g3,f2:Bd6,f6,h6,e5,h4,a3",
+    "B:Wf4,a3,c3,e3,h2,a1,c1,e1:Bb8,d8,f8,h8,c7,d6,f6,h6,c5",
+    "B:Wf4,h4,a3,c1,e1:Bd8,h8,f6,h6,Ka1",
+    "B:Wh6,d4,a3,e3,a1,c1:Bf8,c7,g7,b6,f6",
+};
+
+struct BenchTotals {
+    std::uint64_t nodes = 0;
+    double milliseconds = 0;
+};
+
+void printUsage() {
+    std::cerr << "Usage: checkers-bench [options]\n"
+              << "Searches " << std::size(POSITIONS) << " fixed positions with a fresh hash table each and\n"
+              << "prints nodes, time and the best move.\n"
+              << "  --depth <n>        search depth (default 12)\n"
+              << "  --hash <MB>        hash table size (default 16)\n"
+              << "  --no-pvs           full windows for every hop\n"
+              << "  --no-aspiration    full root window\n"
+              << "  --no-reductions    no late move reductions\n"
+              << "  --no-pruning       no futility pruning\n"
+              << "  --no-quiescence    evaluate at the horizon even if a capture is pending\n"
+              << "  --no-ordering      table hop first, the rest in generated order\n"
+              << "  --configs          totals with every refinement off, each one alone, and all on\n";
+}
+
+// Searches the whole suite; prints a line per position when verbose
+bool runSuite(Engine& engine, int depth, bool verbose, BenchTotals& totals) {
+    SearchLimits limits;
+    limits.depth = depth;
+    int number = 0;
+    for (const char* fen : POSITIONS) {
+        Position position;
+        if (!Position::fromFen(fen, position)) {
+            std::cerr << "Bad benchmark position: " << fen << std::endl;
+            return false;
+        }
+        engine.clear();
+        SearchResult result = engine.search(position, limits);
+        totals.nodes += result.nodes;
+        totals.milliseconds += result.milliseconds;
+        number++;
+        if (!verbose) {
+            continue;
+        }
+
+        std::string move;
+        for (const Hop& hop : result.turn) {
+            move += (move.empty() ? squareName(hop.from) : "") + (hop.captured >= 0 ? "x" : "-") + squareName(hop.to);
+        }
+        std::cout << std::setw(2) << number << "  depth " << result.depth << "  score " << std::setw(6)
+                  << result.score << "  nodes " << std::setw(10) << result.nodes << "  " << std::fixed
+                  << std::setprecision(1) << std::setw(8) << result.milliseconds << " ms  " << move << std::endl;
+    }
+    return true;
+}
+
+void printTotals(const std::string& label, const BenchTotals& totals) {
+    std::cout << label << totals.nodes << " nodes in " << std::fixed << std::setprecision(0) << totals.milliseconds
+              << " ms (" << (totals.milliseconds > 0 ? totals.nodes / totals.milliseconds * 1000 : 0) << " nodes/s)"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int depth = 12;
+    std::size_t hashMegabytes = 16;
+    SearchOptions options;
+    bool compareConfigs = false;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--depth" && i + 1 < argc) {
+                depth = std::stoi(argv[++i]);
+            } else if (arg == "--hash" && i + 1 < argc) {
+                hashMegabytes = static_cast<std::size_t>(std::stoul(argv[++i]));
+            } else if (arg == "--no-pvs") {
+                options.nullWindows = false;
+            } else if (arg == "--no-aspiration") {
+                options.aspiration = false;
+            } else if (arg == "--no-reductions") {
+                options.reductions = false;
+            } else if (arg == "--no-pruning") {
+                options.pruning = false;
+            } else if (arg == "--no-quiescence") {
+                options.quiescence = false;
+            } else if (arg == "--no-ordering") {
+                options.ordering = false;
+            } else if (arg == "--configs") {
+                compareConfigs = true;
+            } else {
+                printUsage();
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception&) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    Engine engine(hashMegabytes);
+    if (!compareConfigs) {
+        engine.setOptions(options);
+        BenchTotals totals;
+        if (!runSuite(engine, depth, true, totals)) {
+            return EXIT_FAILURE;
+        }
+        printTotals("Total: ", totals);
+        return EXIT_SUCCESS;
+    }
+
+    const SearchOptions none{false, false, false, false, false, false};
+    struct Config {
+        const char* name;
+        SearchOptions options;
+    };
+    const Config configs[] = {
+        {"none", none},
+        {"pvs", {true, false, false, false, false, false}},
+        {"aspiration", {false, true, false, false, false, false}},
+        {"reductions", {false, false, true, false, false, false}},
+        {"pruning", {false, false, false, true, false, false}},
+        {"quiescence", {false, false, false, false, true, false}},
+        {"ordering", {false, false, false, false, false, true}},
+        {"all", SearchOptions()},
+    };
+    for (const Config& config : configs) {
+        engine.setOptions(config.options);
+        BenchTotals totals;
+        if (!runSuite(engine, depth, false, totals)) {
+            return EXIT_FAILURE;
+        }
+        std::string label = config.name;
+        printTotals(label + std::string(12 - label.size(), ' '), totals);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+// Game database tool: builds a position-indexed binary store from PDN and queries it
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "../include/GameStore.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void printUsage() {
+    std::cerr << "Usage: checkers-db build <in.pdn> <out.db> [--threads <n>]\n"
+              << "       checkers-db info <store.db>\n"
+              << "       checkers-db query <store.db> <fen> [--limit <n>]\n"
+              << "       checkers-db show <store.db> <game id>\n"
+              << "\n"
+              << "query lists the games that reach a position, given as a PDN FEN such as\n"
+              << "\"B:Wa3,c3,e3:Bb6,d6\" (side to move first). show prints a game as PDN.\n";
+}
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int build(int argc, char* argv[]) {
+    if (argc < 4) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = static_cast<unsigned int>(std::stoi(argv[++i]));
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::ifstream input(argv[2], std::ios::binary);
+    if (!input) {
+        std::cerr << "Cannot open " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto start = Clock::now();
+    GameStoreBuilder builder(threads);
+    if (!builder.build(input, argv[3])) {
+        return EXIT_FAILURE;
+    }
+    double seconds = millisecondsSince(start) / 1000.0;
+    std::cout << builder.getGames() << " games stored, " << builder.getSkipped() << " skipped, "
+              << builder.getMoves() << " move bytes, " << builder.getIndexSize() << " indexed positions\n"
+              << builder.getBytesRead() / (1024.0 * 1024.0) << " MB of PDN in " << seconds << " s on "
+              << threads << " threads (" << (seconds > 0 ? builder.getGames() / seconds : 0) << " games/s)"
+              << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int info(GameStore& store) {
+    std::uint64_t games = store.getGameCount();
+    std::cout << games << " games, " << store.getMoveBytes() << " move bytes ("
+              << (games > 0 ? static_cast<double>(store.getMoveBytes()) / games : 0) << " per game), "
+              << store.getIndexSize() << " indexed positions" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int query(GameStore& store, int argc, char* argv[]) {
+    std::size_t limit = 20;
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--limit" && i + 1 < argc) {
+            limit = static_cast<std::size_t>(std::stoul(argv[++i]));
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    Position position;
+    if (!Position::fromFen(argv[3], position)) {
+        std::cerr << "Invalid FEN: " << argv[3] << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto start = Clock::now();
+    std::size_t total = store.countGames(position);
+    std::vector<std::uint32_t> games = store.findGames(position, limit);
+    double elapsed = millisecondsSince(start);
+
+    int wins[4] = {0, 0, 0, 0};
+    for (std::uint32_t id : games) {
+        wins[static_cast<int>(store.getResult(id))]++;
+    }
+    std::cout << total << " games in " << elapsed << " ms";
+    if (!games.empty()) {
+        std::cout << "; first " << games.size() << ": white won " << wins[static_cast<int>(PdnResult::WhiteWins)]
+                  << ", black won " << wins[static_cast<int>(PdnResult::BlackWins)]
+                  << ", drawn " << wins[static_cast<int>(PdnResult::Draw)] << "\n";
+        for (std::uint32_t id : games) {
+            std::cout << id << ' ' << pdnResultText(store.getResult(id)) << '\n';
+        }
+    } else {
+        std::cout << '\n';
+    }
+    std::cout << std::flush;
+    return EXIT_SUCCESS;
+}
+
+int show(GameStore& store, const std::string& id) {
+    PdnGame game;
+    if (!store.getGame(static_cast<std::uint32_t>(std::stoul(id)), game)) {
+        std::cerr << "No such game: " << id << std::endl;
+        return EXIT_FAILURE;
+    }
+    game.setTag("Event", "Game " + id);
+    game.setTag("GameType", "25");
+    PdnWriter writer(std::cout);
+    writer.write(game);
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    std::string command = argv[1];
+    try {
+        if (command == "build") {
+            return build(argc, argv);
+        }
+
+        GameStore store;
+        if (command == "info") {
+            return store.open(argv[2]) ? info(store) : EXIT_FAILURE;
+        }
+        if (command == "query" && argc >= 4) {
+            return store.open(argv[2]) ? query(store, argc, argv) : EXIT_FAILURE;
+        }
+        if (command == "show" && argc >= 4) {
+            return store.open(argv[2]) ? show(store, argv[3]) : EXIT_FAILURE;
+        }
+    } catch (const std::exception&) {
+        // Malformed numbers in the arguments
+    }
+    printUsage();
+    return EXIT_FAILURE;
+}
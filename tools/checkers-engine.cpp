@@ -0,0 +1,19 @@
+// Standalone engine for GUIs, match runners and bot farms: reads protocol commands from
+// standard input and answers on standard output (see EngineProtocol.hpp)
+#include <cstdlib>
+#include <iostream>
+#include "../include/EngineProtocol.hpp"
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        std::cerr << "Unknown argument " << argv[1] << "\n"
+                  << "Usage: checkers-engine\n"
+                  << "Speaks a Hub-style text protocol on standard input and output; send \"hub\"\n"
+                  << "for its name and parameters and \"quit\" to exit.\n";
+        return EXIT_FAILURE;
+    }
+    std::ios::sync_with_stdio(false);
+    EngineProtocol protocol(std::cin, std::cout);
+    protocol.run();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,562 @@
+// Load generator: simulates many networked players and reports move latency
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/Board.hpp"
+#include "../include/NetworkManager.hpp"
+#include "../include/PlayerController.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadOptions {
+    int clients = 100;
+    int threads = 0;
+    std::string connectIp;          // empty: pair the clients up over loopback
+    std::string serverIp;           // play through checkers-server instead
+    int spectators = 0;             // extra connections watching server games
+    std::uint32_t roomId = 0;       // room the spectators watch, 0 for the newest
+    unsigned short port = 50001;
+    int thinkTimeMs = 0;
+    int durationSec = 30;
+    int maxMoves = 200;
+    unsigned int seed = 1;
+};
+
+struct LoadStats {
+    std::vector<std::uint32_t> roundTripMicros;
+    std::uint64_t movesSent = 0;
+    std::uint64_t gamesCompleted = 0;
+    std::uint64_t connectErrors = 0;
+    std::uint64_t sendErrors = 0;
+    std::uint64_t disconnects = 0;
+    std::uint64_t illegalMoves = 0;
+    std::uint64_t spectatorMoves = 0;
+    std::uint64_t spectatorCatchUps = 0;
+    std::vector<LatencyStats> connections;
+
+    void merge(const LoadStats& other) {
+        roundTripMicros.insert(roundTripMicros.end(), other.roundTripMicros.begin(), other.roundTripMicros.end());
+        movesSent += other.movesSent;
+        gamesCompleted += other.gamesCompleted;
+        connectErrors += other.connectErrors;
+        sendErrors += other.sendErrors;
+        disconnects += other.disconnects;
+        illegalMoves += other.illegalMoves;
+        spectatorMoves += other.spectatorMoves;
+        spectatorCatchUps += other.spectatorCatchUps;
+        connections.insert(connections.end(), other.connections.begin(), other.connections.end());
+    }
+
+    std::uint64_t errors() const {
+        return connectErrors + sendErrors + disconnects + illegalMoves;
+    }
+};
+
+// One side of a networked game, played by a random bot
+class SimulatedPlayer {
+public:
+    SimulatedPlayer(PieceColor color, unsigned int seed)
+        : m_board(720.f), m_controller(seed), m_color(color) {
+    }
+
+    // Colors are assigned by the server when it pairs us with an opponent
+    void waitForServer() { m_inGame = false; }
+
+    NetworkManager& network() { return m_network; }
+    bool isFinished() const { return m_finished; }
+    void setOpponent(const SimulatedPlayer* opponent) { m_opponent = opponent; }
+
+    void start(Clock::time_point now, const LoadOptions& options) {
+        resetGame(now, options);
+    }
+
+    void finish(LoadStats& stats) {
+        stats.connections.push_back(m_network.getLatencyStats());
+        m_finished = true;
+        m_network.disconnect();
+    }
+
+    void poll(Clock::time_point now, const LoadOptions& options, LoadStats& stats) {
+        if (m_finished) {
+            return;
+        }
+        if (m_network.getStatus() == NetworkStatus::Reconnecting) {
+            // The network thread is resuming the game; the server resyncs us
+            return;
+        }
+        if (m_network.getStatus() != NetworkStatus::Connected) {
+            // A remote host may leave once a game is over; anything else is an error
+            if (m_moveCount > 0 || m_gamesPlayed == 0) {
+                stats.disconnects++;
+            }
+            m_finished = true;
+            return;
+        }
+
+        GameStartMessage gameStart;
+        if (m_network.takeGameStart(gameStart)) {
+            m_color = gameStart.color;
+            m_inGame = true;
+            resetGame(now, options);
+        }
+        ResyncMessage resync;
+        if (m_network.takeResync(resync)) {
+            applyResync(now, options, resync);
+        }
+        if (!m_inGame) {
+            return;
+        }
+
+        // Apply the opponent's moves
+        while (m_network.hasReceivedMove()) {
+            NetworkMove move = m_network.getReceivedMove();
+            Board::MoveResult result;
+            if (m_current != m_color) {
+                result = m_board.applyMove(move.fromRow, move.fromCol, move.toRow, move.toCol, m_current);
+            }
+            if (!result.moved) {
+                stats.illegalMoves++;
+                continue;
+            }
+            if (m_awaitingReply) {
+                // Time the opponent spent thinking is not part of the round trip
+                auto roundTrip = now - m_sentAt;
+                if (m_opponent) {
+                    roundTrip -= m_opponent->m_lastHoldTime;
+                } else if (!options.serverIp.empty()) {
+                    roundTrip -= std::chrono::milliseconds(options.thinkTimeMs);
+                }
+                auto micros = std::chrono::duration_cast<std::chrono::microseconds>(roundTrip).count();
+                stats.roundTripMicros.push_back(static_cast<std::uint32_t>(std::max<std::int64_t>(micros, 0)));
+                m_awaitingReply = false;
+            }
+            if (!result.canChain) {
+                endTurn(now, options, stats);
+            }
+        }
+
+        // The server decides when a game ends; queue up for the next one
+        GameOverMessage gameOver;
+        if (m_network.takeGameOver(gameOver)) {
+            if (m_color == PieceColor::White) {
+                stats.gamesCompleted++;
+            }
+            m_gamesPlayed++;
+            m_inGame = false;
+            m_network.disconnect();
+            if (!m_network.connectToGame(options.serverIp, options.port)) {
+                stats.connectErrors++;
+                m_finished = true;
+            }
+            return;
+        }
+
+        // Play our own turn, including every hop of a multi-capture
+        if (m_current == m_color && now >= m_nextMoveAt) {
+            Board::MoveResult result;
+            do {
+                Board::Move move;
+                if (!m_controller.chooseMove(m_board, m_current, move)) {
+                    return;
+                }
+                result = m_board.applyMove(move.fromRow, move.fromCol, move.toRow, move.toCol, m_current);
+                if (!m_network.sendMove(move.fromRow, move.fromCol, move.toRow, move.toCol)) {
+                    stats.sendErrors++;
+                    m_finished = true;
+                    return;
+                }
+                stats.movesSent++;
+            } while (result.canChain);
+
+            m_lastHoldTime = now - m_turnStartedAt;
+            m_sentAt = Clock::now();
+            m_awaitingReply = true;
+            endTurn(now, options, stats);
+        }
+    }
+
+private:
+    NetworkManager m_network;
+    Board m_board;
+    RandomController m_controller;
+    PieceColor m_color;
+    PieceColor m_current = PieceColor::White;
+    int m_moveCount = 0;
+    int m_gamesPlayed = 0;
+    bool m_finished = false;
+    bool m_inGame = true;
+    const SimulatedPlayer* m_opponent = nullptr;
+
+    // Round-trip timing
+    Clock::time_point m_turnStartedAt;
+    Clock::time_point m_nextMoveAt;
+    Clock::time_point m_sentAt;
+    Clock::duration m_lastHoldTime{};
+    bool m_awaitingReply = false;
+
+    void endTurn(Clock::time_point now, const LoadOptions& options, LoadStats& stats) {
+        m_current = (m_current == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+        m_moveCount++;
+
+        // Both sides see the same position, so they restart in step
+        if (options.serverIp.empty() && (m_moveCount >= options.maxMoves || !m_board.hasLegalMove(m_current))) {
+            // Count each game once, on the side that moves first
+            if (m_color == PieceColor::White || !m_opponent) {
+                stats.gamesCompleted++;
+            }
+            m_gamesPlayed++;
+            resetGame(now, options);
+            return;
+        }
+        if (m_current == m_color) {
+            m_turnStartedAt = now;
+            m_nextMoveAt = now + std::chrono::milliseconds(options.thinkTimeMs);
+        }
+    }
+
+    void applyResync(Clock::time_point now, const LoadOptions& options, const ResyncMessage& resync) {
+        m_board.loadPosition(resync.position);
+        m_current = resync.position.getSideToMove();
+        m_moveCount = resync.moveCount;
+        for (const Board::Move& move : resync.moves) {
+            Board::MoveResult result = m_board.applyMove(move.fromRow, move.fromCol, move.toRow, move.toCol, m_current);
+            if (result.moved && !result.canChain) {
+                m_current = (m_current == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+                m_moveCount++;
+            }
+        }
+        m_color = resync.color;
+        m_inGame = true;
+        m_awaitingReply = false;
+        m_turnStartedAt = now;
+        m_nextMoveAt = now + std::chrono::milliseconds(options.thinkTimeMs);
+    }
+
+    void resetGame(Clock::time_point now, const LoadOptions& options) {
+        m_board.initializePieces();
+        m_current = PieceColor::White;
+        m_moveCount = 0;
+        m_awaitingReply = false;
+        m_turnStartedAt = now;
+        m_nextMoveAt = now + std::chrono::milliseconds(options.thinkTimeMs);
+    }
+};
+
+// Watches a server game and checks that every relayed move is legal
+class SimulatedSpectator {
+public:
+    SimulatedSpectator() : m_board(720.f) {
+    }
+
+    NetworkManager& network() { return m_network; }
+    bool isFinished() const { return m_finished; }
+
+    void finish(LoadStats& stats) {
+        stats.connections.push_back(m_network.getLatencyStats());
+        m_finished = true;
+        m_network.disconnect();
+    }
+
+    void poll(Clock::time_point now, const LoadOptions& options, LoadStats& stats) {
+        if (m_finished || now < m_retryAt) {
+            return;
+        }
+        if (m_network.getStatus() == NetworkStatus::Disconnected) {
+            // Reconnect after a game ended
+            if (!m_network.watchGame(options.serverIp, options.port, options.roomId)) {
+                stats.connectErrors++;
+                m_finished = true;
+            }
+            return;
+        }
+        if (m_network.getStatus() != NetworkStatus::Connected) {
+            return;
+        }
+
+        SpectateMessage spectate;
+        if (m_network.takeSpectate(spectate)) {
+            // A second snapshot means we fell behind and the server skipped moves
+            if (m_watching) {
+                stats.spectatorCatchUps++;
+            }
+            m_board.loadPosition(spectate.position);
+            m_current = spectate.position.getSideToMove();
+            m_watching = true;
+        }
+
+        while (m_network.hasReceivedMove()) {
+            NetworkMove move = m_network.getReceivedMove();
+            Board::MoveResult result = m_board.applyMove(move.fromRow, move.fromCol, move.toRow, move.toCol, m_current);
+            if (!result.moved) {
+                stats.illegalMoves++;
+                continue;
+            }
+            stats.spectatorMoves++;
+            if (!result.canChain) {
+                m_current = (m_current == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+            }
+        }
+
+        // Follow the next game once this one is over (or none was running yet)
+        GameOverMessage gameOver;
+        if (m_network.takeGameOver(gameOver)) {
+            m_watching = false;
+            m_network.disconnect();
+            if (gameOver.reason == GameOverReason::Abandoned) {
+                m_retryAt = now + std::chrono::milliseconds(100);
+            }
+        }
+    }
+
+private:
+    NetworkManager m_network;
+    Board m_board;
+    PieceColor m_current = PieceColor::White;
+    bool m_watching = false;
+    bool m_finished = false;
+    Clock::time_point m_retryAt;
+};
+
+void printUsage() {
+    std::cerr << "Usage: checkers-loadgen [options]\n"
+              << "  --clients <n>      simulated players (default 100)\n"
+              << "  --connect <ip>     connect to hosts at <ip>, one per port starting at --port;\n"
+              << "                     without it the clients are paired up over loopback\n"
+              << "  --server <ip>      play every client through checkers-server at <ip>:<port>;\n"
+              << "                     the server pairs clients, ends games and keeps the clocks\n"
+              << "  --spectators <n>   with --server: extra connections watching games\n"
+              << "  --room <n>         room the spectators watch (default: the newest game)\n"
+              << "  --port <n>         first port (default 50001)\n"
+              << "  --threads <n>      driver threads (default: all cores)\n"
+              << "  --think-ms <n>     delay before each move (default 0)\n"
+              << "  --duration <s>     test length in seconds (default 30)\n"
+              << "  --max-moves <n>    restart a game after this many moves (default 200,\n"
+              << "                     use the same value as the hosts)\n"
+              << "  --seed <n>         random seed (default 1)\n";
+}
+
+bool parseOptions(int argc, char* argv[], LoadOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--clients") {
+            options.clients = std::stoi(value);
+        } else if (arg == "--connect") {
+            options.connectIp = value;
+        } else if (arg == "--server") {
+            options.serverIp = value;
+        } else if (arg == "--spectators") {
+            options.spectators = std::stoi(value);
+        } else if (arg == "--room") {
+            options.roomId = static_cast<std::uint32_t>(std::stoul(value));
+        } else if (arg == "--port") {
+            options.port = static_cast<unsigned short>(std::stoi(value));
+        } else if (arg == "--threads") {
+            options.threads = std::stoi(value);
+        } else if (arg == "--think-ms") {
+            options.thinkTimeMs = std::stoi(value);
+        } else if (arg == "--duration") {
+            options.durationSec = std::stoi(value);
+        } else if (arg == "--max-moves") {
+            options.maxMoves = std::stoi(value);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<unsigned int>(std::stoul(value));
+        } else {
+            return false;
+        }
+    }
+    return options.clients > 0 && (options.spectators == 0 || !options.serverIp.empty());
+}
+
+// Opens every connection; returns the players grouped so that paired players share a group
+std::vector<std::vector<SimulatedPlayer*>> connectPlayers(const LoadOptions& options,
+                                                           std::vector<std::unique_ptr<SimulatedPlayer>>& players,
+                                                           LoadStats& stats) {
+    std::vector<std::vector<SimulatedPlayer*>> groups;
+    bool server = !options.serverIp.empty();
+    bool paired = !server && options.connectIp.empty();
+    int connections = paired ? options.clients / 2 : options.clients;
+
+    for (int i = 0; i < connections; i++) {
+        unsigned short port = static_cast<unsigned short>(options.port + i);
+        if (server) {
+            // The server pairs clients in arrival order; one group each keeps them independent
+            auto client = std::make_unique<SimulatedPlayer>(PieceColor::White, options.seed + i);
+            client->waitForServer();
+            if (!client->network().connectToGame(options.serverIp, options.port)) {
+                stats.connectErrors++;
+                continue;
+            }
+            groups.push_back({client.get()});
+            players.push_back(std::move(client));
+        } else if (paired) {
+            auto host = std::make_unique<SimulatedPlayer>(PieceColor::White, options.seed + 2 * i);
+            auto client = std::make_unique<SimulatedPlayer>(PieceColor::Black, options.seed + 2 * i + 1);
+            if (!host->network().hostGame(port) || !client->network().connectToGame("127.0.0.1", port)) {
+                stats.connectErrors++;
+                continue;
+            }
+            host->setOpponent(client.get());
+            client->setOpponent(host.get());
+            groups.push_back({host.get(), client.get()});
+            players.push_back(std::move(host));
+            players.push_back(std::move(client));
+        } else {
+            // The remote host plays White and moves first
+            auto client = std::make_unique<SimulatedPlayer>(PieceColor::Black, options.seed + i);
+            if (!client->network().connectToGame(options.connectIp, port)) {
+                stats.connectErrors++;
+                continue;
+            }
+            groups.push_back({client.get()});
+            players.push_back(std::move(client));
+        }
+    }
+
+    // Hosts accept on their own threads; wait until they have all seen their client
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    for (auto& player : players) {
+        while (player->network().getStatus() != NetworkStatus::Connected && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    return groups;
+}
+
+double percentile(const std::vector<std::uint32_t>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    std::size_t index = static_cast<std::size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[index] / 1000.0;
+}
+
+void printReport(const LoadOptions& options, LoadStats& stats, double seconds) {
+    std::vector<std::uint32_t>& samples = stats.roundTripMicros;
+    std::sort(samples.begin(), samples.end());
+    double errorRate = stats.movesSent ? 100.0 * stats.errors() / stats.movesSent : 0.0;
+
+    // Per-connection ping estimates
+    double pingSum = 0.0, pingMax = 0.0, offsetMax = 0.0;
+    int pinged = 0;
+    for (const LatencyStats& latency : stats.connections) {
+        if (latency.pongsReceived == 0) {
+            continue;
+        }
+        pingSum += latency.smoothedRttMs;
+        pingMax = std::max(pingMax, latency.smoothedRttMs);
+        offsetMax = std::max(offsetMax, std::abs(latency.clockOffsetMs));
+        pinged++;
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "clients          " << options.clients << (!options.serverIp.empty() ? " (via server)" : options.connectIp.empty() ? " (loopback pairs)" : "") << "\n"
+              << "duration         " << seconds << " s\n"
+              << "games completed  " << stats.gamesCompleted << "\n"
+              << "moves sent       " << stats.movesSent << " (" << stats.movesSent / seconds << " moves/s)\n"
+              << "round trips      " << samples.size() << "\n"
+              << "latency p50      " << percentile(samples, 0.50) << " ms\n"
+              << "latency p99      " << percentile(samples, 0.99) << " ms\n"
+              << "latency p999     " << percentile(samples, 0.999) << " ms\n"
+              << "latency max      " << (samples.empty() ? 0.0 : samples.back() / 1000.0) << " ms\n"
+              << "ping rtt         " << (pinged ? pingSum / pinged : 0.0) << " ms avg, " << pingMax << " ms max\n"
+              << "clock offset     " << offsetMax << " ms max\n"
+              << "spectators       " << options.spectators << ": " << stats.spectatorMoves << " moves received, "
+              << stats.spectatorCatchUps << " catch-up snapshots\n"
+              << "errors           " << stats.errors() << " (" << errorRate << "% of moves):"
+              << " connect " << stats.connectErrors
+              << ", send " << stats.sendErrors
+              << ", disconnect " << stats.disconnects
+              << ", illegal " << stats.illegalMoves << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception&) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    LoadStats total;
+    std::vector<std::unique_ptr<SimulatedPlayer>> players;
+    std::vector<std::vector<SimulatedPlayer*>> groups = connectPlayers(options, players, total);
+    if (groups.empty()) {
+        std::cerr << "Error: no connections could be opened" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Spectators connect on their first poll, once the players' games have started
+    std::vector<std::unique_ptr<SimulatedSpectator>> spectators;
+    for (int i = 0; i < options.spectators; i++) {
+        spectators.push_back(std::make_unique<SimulatedSpectator>());
+    }
+
+    // Each driver thread owns a slice of the groups, so paired players never race
+    int threadCount = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threadCount = std::max(1, std::min(threadCount, static_cast<int>(groups.size())));
+    std::vector<LoadStats> threadStats(threadCount);
+    std::vector<std::thread> threads;
+
+    auto startTime = Clock::now();
+    auto endTime = startTime + std::chrono::seconds(options.durationSec);
+    for (auto& player : players) {
+        player->start(startTime, options);
+    }
+
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            while (Clock::now() < endTime) {
+                bool active = false;
+                for (std::size_t g = t; g < groups.size(); g += threadCount) {
+                    for (SimulatedPlayer* player : groups[g]) {
+                        player->poll(Clock::now(), options, threadStats[t]);
+                        active = active || !player->isFinished();
+                    }
+                }
+                for (std::size_t s = t; s < spectators.size(); s += threadCount) {
+                    spectators[s]->poll(Clock::now(), options, threadStats[t]);
+                }
+                if (!active) {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+    for (auto& player : players) {
+        player->finish(total);
+    }
+    for (auto& spectator : spectators) {
+        spectator->finish(total);
+    }
+    for (const LoadStats& stats : threadStats) {
+        total.merge(stats);
+    }
+    printReport(options, total, seconds);
+    return total.errors() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
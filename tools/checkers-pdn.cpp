@@ -0,0 +1,114 @@
+// PDN archive tool: checks every game against the rules and rewrites archives in normalized form
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "../include/Pdn.hpp"
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: checkers-pdn check <in.pdn> [options]\n"
+              << "       checkers-pdn convert <in.pdn> <out.pdn> [options]\n"
+              << "  --no-validate      only parse, do not replay the moves\n"
+              << "  --max-errors <n>   report at most this many bad games (default 20)\n"
+              << "\n"
+              << "convert writes the valid games with full capture paths in algebraic notation\n"
+              << "and skips the rest. Use - for standard input or output.\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    std::string command = argv[1];
+    std::string inputPath = argv[2];
+    std::string outputPath;
+    int next = 3;
+    if (command == "convert") {
+        if (argc < 4) {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+        outputPath = argv[next++];
+    } else if (command != "check") {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    bool validate = true;
+    int maxErrors = 20;
+    try {
+        for (int i = next; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--no-validate") {
+                validate = false;
+            } else if (arg == "--max-errors" && i + 1 < argc) {
+                maxErrors = std::stoi(argv[++i]);
+            } else {
+                printUsage();
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception&) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream inputFile;
+    if (inputPath != "-") {
+        inputFile.open(inputPath, std::ios::binary);
+        if (!inputFile) {
+            std::cerr << "Cannot open " << inputPath << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::ofstream outputFile;
+    if (!outputPath.empty() && outputPath != "-") {
+        outputFile.open(outputPath, std::ios::binary);
+        if (!outputFile) {
+            std::cerr << "Cannot create " << outputPath << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::istream& input = inputPath == "-" ? std::cin : inputFile;
+    std::ostream& output = outputPath == "-" ? std::cout : outputFile;
+
+    PdnReader reader(input);
+    reader.setValidate(validate);
+    PdnWriter writer(output);
+    PdnGame game;
+    std::uint64_t badGames = 0;
+    std::uint64_t moves = 0;
+    auto startTime = std::chrono::steady_clock::now();
+
+    while (reader.next(game)) {
+        if (!game.error.empty()) {
+            if (static_cast<int>(badGames) < maxErrors) {
+                std::cerr << "game " << reader.getGamesRead() << ": " << game.error << std::endl;
+            }
+            badGames++;
+            continue;
+        }
+        moves += game.moves.size();
+        if (!outputPath.empty()) {
+            writer.write(game);
+        }
+    }
+    output.flush();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    double megabytes = reader.getBytesRead() / (1024.0 * 1024.0);
+    std::cerr << reader.getGamesRead() << " games, " << badGames << " with errors, "
+              << moves << " moves in " << megabytes << " MB, "
+              << seconds << " s (" << (seconds > 0 ? megabytes / seconds : 0) << " MB/s, "
+              << (seconds > 0 ? reader.getGamesRead() / seconds : 0) << " games/s)" << std::endl;
+    if (!outputPath.empty()) {
+        std::cerr << writer.getGamesWritten() << " games written" << std::endl;
+    }
+    return badGames == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,104 @@
+// Game server: pairs up clients, validates their moves and keeps the game clocks
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "../include/GameServer.hpp"
+
+namespace {
+
+GameServer* g_server = nullptr;
+
+void handleSignal(int) {
+    if (g_server) {
+        g_server->stop();
+    }
+}
+
+void printUsage() {
+    std::cerr << "Usage: checkers-server [options]\n"
+              << "  --port <n>         listening port (default 50001)\n"
+              << "  --time <m>+<s>     Fischer clock: minutes per game plus seconds per move\n"
+              << "                     (default 5+3), or \"none\" for untimed games\n"
+              << "  --delay <m>+<s>    delay clock: each move's first <s> seconds are free\n"
+              << "  --max-lag-ms <n>   most network lag refunded per move (default 500)\n"
+              << "  --max-moves <n>    declare a draw after this many moves, 0 for no limit (default 500)\n"
+              << "  --resume-s <n>     how long a dropped player's seat is held (default 30)\n"
+              << "  --journal <file>   log every game to <file> and restore running games from it on start\n"
+              << "\n"
+              << "Every client takes one open file; raise the limit (ulimit -n) for more than about\n"
+              << "a thousand.\n";
+}
+
+bool parseTimeControl(const std::string& value, TimeControlType type, TimeControl& timeControl) {
+    if (value == "none") {
+        timeControl = TimeControl{};
+        return true;
+    }
+    std::size_t plus = value.find('+');
+    if (plus == std::string::npos) {
+        return false;
+    }
+    timeControl.type = type;
+    timeControl.initialMicros = static_cast<std::int64_t>(std::stod(value.substr(0, plus)) * 60000000.0);
+    timeControl.incrementMicros = static_cast<std::int64_t>(std::stod(value.substr(plus + 1)) * 1000000.0);
+    return timeControl.initialMicros > 0 && timeControl.incrementMicros >= 0;
+}
+
+bool parseOptions(int argc, char* argv[], ServerOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--port") {
+            options.port = static_cast<unsigned short>(std::stoi(value));
+        } else if (arg == "--time") {
+            if (!parseTimeControl(value, TimeControlType::Fischer, options.timeControl)) {
+                return false;
+            }
+        } else if (arg == "--delay") {
+            if (!parseTimeControl(value, TimeControlType::Delay, options.timeControl)) {
+                return false;
+            }
+        } else if (arg == "--max-lag-ms") {
+            options.maxLagCompensationMicros = std::stoll(value) * 1000;
+        } else if (arg == "--max-moves") {
+            options.maxMoves = std::stoi(value);
+        } else if (arg == "--resume-s") {
+            options.resumeWindowMicros = std::stoll(value) * 1000000;
+        } else if (arg == "--journal") {
+            options.journalPath = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ServerOptions options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception&) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    GameServer server(options);
+    if (!server.start()) {
+        return EXIT_FAILURE;
+    }
+
+    g_server = &server;
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+    server.run();
+    return EXIT_SUCCESS;
+}
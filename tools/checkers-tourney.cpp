@@ -0,0 +1,491 @@
+// Self-play tournament: two engine configurations play each other from a set of openings
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../include/Engine.hpp"
+#include "../include/Pdn.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// One side of the match, given on the command line as "depth=6,hash=16,network=a.nn"
+struct EngineSpec {
+    std::string name;
+    SearchLimits limits;
+    std::size_t hashMegabytes = 16;
+    std::string networkPath;
+    std::shared_ptr<const Network> network;
+    std::string weightsPath;
+    EvalWeights weights;
+    SearchOptions options;
+};
+
+struct TourneyOptions {
+    EngineSpec engines[2];
+    int games = 1000;
+    int threads = 0;
+    std::string openingsPath;       // FEN per line; random openings without it
+    int openingMoves = 4;
+    int maxMoves = 200;
+    std::string pdnPath;
+    bool sprt = false;
+    double elo0 = 0;
+    double elo1 = 5;
+    double alpha = 0.05;
+    double beta = 0.05;
+    unsigned int seed = 1;
+};
+
+struct Opening {
+    Position start;
+    std::vector<PdnMove> moves;     // played from the initial position, if not from FEN
+    bool fromFen = false;
+};
+
+// Wins, losses and draws of the first engine
+struct MatchScore {
+    int wins = 0;
+    int losses = 0;
+    int draws = 0;
+
+    int games() const { return wins + losses + draws; }
+    double score() const { return games() > 0 ? (wins + 0.5 * draws) / games() : 0.5; }
+    // Variance of a single game's score
+    double variance() const {
+        double s = score();
+        return games() > 0 ? (wins * (1 - s) * (1 - s) + losses * s * s + draws * (0.5 - s) * (0.5 - s)) / games() : 0;
+    }
+};
+
+double eloFromScore(double score) {
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+double scoreFromElo(double elo) {
+    return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+// Log-likelihood ratio of elo1 against elo0, with game scores taken as normal
+double logLikelihoodRatio(const MatchScore& match, double elo0, double elo1) {
+    double variance = match.variance();
+    if (match.games() == 0 || variance <= 0) {
+        return 0;
+    }
+    double s0 = scoreFromElo(elo0);
+    double s1 = scoreFromElo(elo1);
+    return (s1 - s0) * (2 * match.score() - s0 - s1) * match.games() / (2 * variance);
+}
+
+void printUsage() {
+    std::cerr << "Usage: checkers-tourney [options]\n"
+              << "  --engine1 <spec>   first engine (default depth=6)\n"
+              << "  --engine2 <spec>   second engine (default depth=6)\n"
+              << "                     spec: comma separated depth=<n>, nodes=<n>, ms=<n>,\n"
+              << "                     hash=<MB>, network=<file>, weights=<file>,\n"
+              << "                     name=<text>; pvs, aspiration, reductions, pruning,\n"
+              << "                     quiescence and ordering =0 turn those search\n"
+              << "                     refinements off\n"
+              << "  --games <n>        games to play, two per opening (default 1000)\n"
+              << "  --threads <n>      games played at once (default: all cores)\n"
+              << "  --openings <file>  one FEN per line (default: random balanced openings)\n"
+              << "  --opening-moves <n> length of random openings (default 4)\n"
+              << "  --max-moves <n>    adjudicate a draw after this many moves (default 200)\n"
+              << "  --pdn <file>       write every game as PDN\n"
+              << "  --sprt <e0>,<e1>   stop once engine1 is shown to be e0 or e1 Elo stronger\n"
+              << "  --alpha <p>        SPRT false positive rate (default 0.05)\n"
+              << "  --beta <p>         SPRT false negative rate (default 0.05)\n"
+              << "  --seed <n>         random seed for the openings (default 1)\n";
+}
+
+bool parseEngineSpec(const std::string& text, EngineSpec& spec) {
+    std::istringstream fields(text);
+    std::string field;
+    while (std::getline(fields, field, ',')) {
+        std::size_t equals = field.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        std::string key = field.substr(0, equals);
+        std::string value = field.substr(equals + 1);
+        if (key == "depth") {
+            spec.limits.depth = std::stoi(value);
+        } else if (key == "nodes") {
+            spec.limits.nodes = std::stoull(value);
+        } else if (key == "ms") {
+            spec.limits.milliseconds = std::stoi(value);
+        } else if (key == "hash") {
+            spec.hashMegabytes = static_cast<std::size_t>(std::stoul(value));
+        } else if (key == "network") {
+            spec.networkPath = value;
+        } else if (key == "weights") {
+            spec.weightsPath = value;
+        } else if (key == "pvs") {
+            spec.options.nullWindows = value != "0";
+        } else if (key == "aspiration") {
+            spec.options.aspiration = value != "0";
+        } else if (key == "reductions") {
+            spec.options.reductions = value != "0";
+        } else if (key == "pruning") {
+            spec.options.pruning = value != "0";
+        } else if (key == "quiescence") {
+            spec.options.quiescence = value != "0";
+        } else if (key == "ordering") {
+            spec.options.ordering = value != "0";
+        } else if (key == "name") {
+            spec.name = value;
+        } else {
+            return false;
+        }
+    }
+    if (spec.name.empty()) {
+        spec.name = text;
+    }
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], TourneyOptions& options) {
+    std::string specs[2] = {"depth=6", "depth=6"};
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--engine1") {
+            specs[0] = value;
+        } else if (arg == "--engine2") {
+            specs[1] = value;
+        } else if (arg == "--games") {
+            options.games = std::stoi(value);
+        } else if (arg == "--threads") {
+            options.threads = std::stoi(value);
+        } else if (arg == "--openings") {
+            options.openingsPath = value;
+        } else if (arg == "--opening-moves") {
+            options.openingMoves = std::stoi(value);
+        } else if (arg == "--max-moves") {
+            options.maxMoves = std::stoi(value);
+        } else if (arg == "--pdn") {
+            options.pdnPath = value;
+        } else if (arg == "--sprt") {
+            std::size_t comma = value.find(',');
+            if (comma == std::string::npos) {
+                return false;
+            }
+            options.sprt = true;
+            options.elo0 = std::stod(value.substr(0, comma));
+            options.elo1 = std::stod(value.substr(comma + 1));
+        } else if (arg == "--alpha") {
+            options.alpha = std::stod(value);
+        } else if (arg == "--beta") {
+            options.beta = std::stod(value);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<unsigned int>(std::stoul(value));
+        } else {
+            return false;
+        }
+    }
+    for (int side = 0; side < 2; side++) {
+        if (!parseEngineSpec(specs[side], options.engines[side])) {
+            return false;
+        }
+    }
+    if (options.engines[0].name == options.engines[1].name) {
+        options.engines[0].name += " (1)";
+        options.engines[1].name += " (2)";
+    }
+    return options.games > 0 && options.maxMoves > 0;
+}
+
+PdnMove toPdnMove(const std::vector<Hop>& turn) {
+    PdnMove move;
+    move.squares[move.count++] = static_cast<std::uint8_t>(turn.front().from);
+    for (const Hop& hop : turn) {
+        if (move.count < move.squares.size()) {
+            move.squares[move.count++] = static_cast<std::uint8_t>(hop.to);
+        }
+        move.capture = move.capture || hop.captured >= 0;
+    }
+    return move;
+}
+
+// Plays random turns from the initial position and keeps openings that a short search
+// scores as roughly even, each position only once
+std::vector<Opening> randomOpenings(const TourneyOptions& options, int count) {
+    std::mt19937 rng(options.seed);
+    Engine judge(4);
+    SearchLimits limits;
+    limits.depth = 6;
+    std::vector<Opening> openings;
+    std::vector<std::uint64_t> seen;
+    std::vector<Hop> hops;
+    for (int attempt = 0; attempt < count * 100 && static_cast<int>(openings.size()) < count; attempt++) {
+        Opening opening;
+        opening.start = EngineRules::initial();
+        bool finished = false;
+        for (int move = 0; move < options.openingMoves && !finished; move++) {
+            std::vector<Hop> turn;
+            do {
+                EngineRules::generateHops(opening.start, opening.start.getSideToMove(), hops);
+                if (hops.empty()) {
+                    finished = true;
+                    break;
+                }
+                turn.push_back(hops[std::uniform_int_distribution<std::size_t>(0, hops.size() - 1)(rng)]);
+            } while (EngineRules::applyHop(opening.start, turn.back()));
+            if (!turn.empty()) {
+                opening.moves.push_back(toPdnMove(turn));
+            }
+        }
+        std::uint64_t hash = opening.start.hash();
+        if (finished || std::find(seen.begin(), seen.end(), hash) != seen.end()) {
+            continue;
+        }
+        if (std::abs(judge.search(opening.start, limits).score) > 60) {
+            continue;
+        }
+        seen.push_back(hash);
+        openings.push_back(opening);
+    }
+    return openings;
+}
+
+bool loadOpenings(const std::string& path, std::vector<Opening>& openings) {
+    std::ifstream input(path);
+    if (!input) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(input, line)) {
+        lineNumber++;
+        std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        Opening opening;
+        opening.fromFen = true;
+        if (!Position::fromFen(line.substr(first), opening.start)) {
+            std::cerr << path << ":" << lineNumber << ": invalid FEN" << std::endl;
+            return false;
+        }
+        openings.push_back(opening);
+    }
+    return true;
+}
+
+// Plays one game; returns the result for White
+PdnResult playGame(const Opening& opening, Engine* white, const EngineSpec& whiteSpec, Engine* black,
+                   const EngineSpec& blackSpec, int maxMoves, PdnGame& game) {
+    Position position = opening.start;
+    game.moves = opening.moves;
+    white->clear();
+    black->clear();
+
+    std::unordered_map<std::uint64_t, int> repetitions;
+    std::vector<Hop> hops;
+    for (int move = 0; move < maxMoves; move++) {
+        if (++repetitions[position.hash()] >= 3) {
+            return PdnResult::Draw;
+        }
+        bool whiteToMove = position.getSideToMove() == PieceColor::White;
+        EngineRules::generateHops(position, position.getSideToMove(), hops);
+        if (hops.empty()) {
+            return whiteToMove ? PdnResult::BlackWins : PdnResult::WhiteWins;
+        }
+
+        SearchResult result = whiteToMove ? white->search(position, whiteSpec.limits)
+                                          : black->search(position, blackSpec.limits);
+        for (const Hop& hop : result.turn) {
+            Hop legal;
+            if (!EngineRules::findHop(position, hop.from, hop.to, legal)) {
+                // Should never happen; count it against the engine that played it
+                std::cerr << "Illegal move from " << (whiteToMove ? whiteSpec.name : blackSpec.name) << std::endl;
+                return whiteToMove ? PdnResult::BlackWins : PdnResult::WhiteWins;
+            }
+            EngineRules::applyHop(position, hop);
+        }
+        game.moves.push_back(toPdnMove(result.turn));
+    }
+    return PdnResult::Draw;
+}
+
+void printStatus(const TourneyOptions& options, const MatchScore& match, double llr) {
+    double score = match.score();
+    double margin = 1.96 * std::sqrt(match.variance() / std::max(1, match.games()));
+    double elo = eloFromScore(score);
+    std::cout << std::fixed << std::setprecision(1) << "Games " << match.games() << ": +" << match.wins << " -"
+              << match.losses << " =" << match.draws << "  Elo " << elo << " ["
+              << eloFromScore(score - margin) << ", " << eloFromScore(score + margin) << "]";
+    if (options.sprt) {
+        std::cout << std::setprecision(2) << "  LLR " << llr << " ("
+                  << std::log(options.beta / (1 - options.alpha)) << ", "
+                  << std::log((1 - options.beta) / options.alpha) << ")";
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    TourneyOptions options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception&) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    for (EngineSpec& spec : options.engines) {
+        if (!spec.networkPath.empty()) {
+            auto network = std::make_shared<Network>();
+            if (!network->load(spec.networkPath)) {
+                return EXIT_FAILURE;
+            }
+            spec.network = network;
+        }
+        if (!spec.weightsPath.empty() && !spec.weights.load(spec.weightsPath)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Every opening is played twice, once with each engine as White
+    std::vector<Opening> openings;
+    int pairs = (options.games + 1) / 2;
+    if (!options.openingsPath.empty()) {
+        if (!loadOpenings(options.openingsPath, openings)) {
+            return EXIT_FAILURE;
+        }
+    } else {
+        openings = randomOpenings(options, pairs);
+    }
+    if (openings.empty()) {
+        std::cerr << "Error: no openings" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream pdnFile;
+    std::unique_ptr<PdnWriter> writer;
+    if (!options.pdnPath.empty()) {
+        pdnFile.open(options.pdnPath);
+        if (!pdnFile) {
+            std::cerr << "Cannot open " << options.pdnPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        writer = std::make_unique<PdnWriter>(pdnFile);
+    }
+
+    int threadCount = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threadCount = std::max(1, std::min(threadCount, options.games));
+    std::cout << options.engines[0].name << " vs " << options.engines[1].name << ": " << options.games
+              << " games from " << openings.size() << " openings on " << threadCount << " threads" << std::endl;
+
+    std::atomic<int> nextGame{0};
+    std::atomic<bool> stopping{false};
+    std::mutex resultsMutex;
+    MatchScore match;
+    double llr = 0;
+    int reportEvery = std::max(10, options.games / 20);
+    auto start = Clock::now();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&]() {
+            std::unique_ptr<Engine> engines[2];
+            for (int side = 0; side < 2; side++) {
+                engines[side] = std::make_unique<Engine>(options.engines[side].hashMegabytes);
+                engines[side]->setNetwork(options.engines[side].network);
+                engines[side]->setWeights(options.engines[side].weights);
+                engines[side]->setOptions(options.engines[side].options);
+            }
+            PdnGame game;
+            for (int index = nextGame++; index < options.games && !stopping; index = nextGame++) {
+                const Opening& opening = openings[(index / 2) % openings.size()];
+                int whiteSide = index % 2;
+                const EngineSpec& whiteSpec = options.engines[whiteSide];
+                const EngineSpec& blackSpec = options.engines[1 - whiteSide];
+
+                game.clear();
+                game.result = playGame(opening, engines[whiteSide].get(), whiteSpec, engines[1 - whiteSide].get(),
+                                       blackSpec, options.maxMoves, game);
+                game.setTag("Event", "checkers-tourney");
+                game.setTag("Round", std::to_string(index + 1));
+                game.setTag("White", whiteSpec.name);
+                game.setTag("Black", blackSpec.name);
+                game.setTag("GameType", "25");
+                if (opening.fromFen) {
+                    game.start = opening.start;
+                    game.setTag("FEN", opening.start.toFen());
+                }
+                game.setTag("Result", pdnResultText(game.result));
+
+                std::lock_guard<std::mutex> lock(resultsMutex);
+                if (stopping) {
+                    // SPRT has decided; games still running when it did are not counted
+                    break;
+                }
+                if (writer) {
+                    writer->write(game);
+                }
+                bool firstIsWhite = whiteSide == 0;
+                if (game.result == PdnResult::Draw) {
+                    match.draws++;
+                } else if ((game.result == PdnResult::WhiteWins) == firstIsWhite) {
+                    match.wins++;
+                } else {
+                    match.losses++;
+                }
+                if (options.sprt) {
+                    llr = logLikelihoodRatio(match, options.elo0, options.elo1);
+                    if (llr <= std::log(options.beta / (1 - options.alpha)) ||
+                        llr >= std::log((1 - options.beta) / options.alpha)) {
+                        stopping = true;
+                    }
+                }
+                if (match.games() % reportEvery == 0) {
+                    printStatus(options, match, llr);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printStatus(options, match, llr);
+    std::cout << std::setprecision(1) << match.games() << " games in " << seconds << " s ("
+              << (seconds > 0 ? match.games() / seconds : 0) << " games/s)" << std::endl;
+    if (options.sprt) {
+        if (llr >= std::log((1 - options.beta) / options.alpha)) {
+            std::cout << "SPRT: H1 accepted (" << options.engines[0].name << " is " << options.elo1
+                      << " Elo stronger)" << std::endl;
+        } else if (llr <= std::log(options.beta / (1 - options.alpha))) {
+            std::cout << "SPRT: H0 accepted (" << options.engines[0].name << " is " << options.elo0
+                      << " Elo stronger)" << std::endl;
+        } else {
+            std::cout << "SPRT: inconclusive" << std::endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+// Evaluation tuner: fits the evaluator weights to the results of archived games
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "../include/Tuner.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void printUsage() {
+    std::cerr << "Usage: checkers-tune <games.pdn> [options]\n"
+              << "  --threads <n>      threads for the loss (default: all cores)\n"
+              << "  --iterations <n>   gradient steps (default 500)\n"
+              << "  --rate <x>         largest step per weight and iteration (default 1)\n"
+              << "  --skip-moves <n>   opening moves left out of every game (default 8)\n"
+              << "  --start <file>     weights to start from (default: built-in)\n"
+              << "  --out <file>       where to write the tuned weights (default weights.txt)\n";
+}
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void printWeights(const Tuner::Weights& weights) {
+    for (int term = 0; term < EvalWeights::TERMS; term++) {
+        std::cout << (term > 0 ? " " : "") << EvalWeights::NAMES[term] << '=' << weights[term];
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    int iterations = 500;
+    double rate = 1.0;
+    int skipMoves = 8;
+    std::string startPath;
+    std::string outPath = "weights.txt";
+    try {
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--threads" && i + 1 < argc) {
+                threads = static_cast<unsigned int>(std::stoi(argv[++i]));
+            } else if (arg == "--iterations" && i + 1 < argc) {
+                iterations = std::stoi(argv[++i]);
+            } else if (arg == "--rate" && i + 1 < argc) {
+                rate = std::stod(argv[++i]);
+            } else if (arg == "--skip-moves" && i + 1 < argc) {
+                skipMoves = std::stoi(argv[++i]);
+            } else if (arg == "--start" && i + 1 < argc) {
+                startPath = argv[++i];
+            } else if (arg == "--out" && i + 1 < argc) {
+                outPath = argv[++i];
+            } else {
+                printUsage();
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception&) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    EvalWeights initial;
+    if (!startPath.empty() && !initial.load(startPath)) {
+        return EXIT_FAILURE;
+    }
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input) {
+        std::cerr << "Cannot open " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto start = Clock::now();
+    Tuner tuner(threads);
+    // Moves count both sides, as in the PDN movetext
+    if (!tuner.load(input, 2 * skipMoves)) {
+        return EXIT_FAILURE;
+    }
+    std::cout << tuner.getPositions().size() << " positions from " << tuner.getGames() << " games ("
+              << tuner.getSkippedGames() << " skipped) in " << secondsSince(start) << " s" << std::endl;
+    if (tuner.getPositions().size() == 0) {
+        std::cerr << "No positions to tune on" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    start = Clock::now();
+    Tuner::Weights weights = Tuner::toWeights(initial);
+    double scale = tuner.fitScale(weights);
+    std::cout << "scale " << scale << ", loss " << tuner.loss(weights, scale) << std::endl;
+    weights = tuner.tune(weights, scale, iterations, rate,
+                         [&](int iteration, double loss, const Tuner::Weights& current) {
+                             if (iteration % 50 == 0 || iteration == iterations) {
+                                 std::cout << "iteration " << iteration << " loss " << loss << ": ";
+                                 printWeights(current);
+                             }
+                         });
+    double seconds = secondsSince(start);
+    std::cout << "final loss " << tuner.loss(weights, scale) << " after " << seconds << " s ("
+              << (seconds > 0 ? iterations * static_cast<double>(tuner.getPositions().size()) / seconds / 1e6 : 0)
+              << "M positions/s on " << threads << " threads)" << std::endl;
+
+    if (!Tuner::fromWeights(weights).save(outPath)) {
+        return EXIT_FAILURE;
+    }
+    std::cout << "weights written to " << outPath << std::endl;
+    return EXIT_SUCCESS;
+}